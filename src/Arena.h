@@ -0,0 +1,168 @@
+//
+//  Arena.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MemoryResource.h"
+
+// A memory resource that hands memory out of big blocks and takes it all
+// back at once: deallocate() does nothing, destroying or reset()ting the
+// arena frees every block. Containers given one (ResourceVector) cost a
+// few frees to tear down, however many allocations they made. Blocks past
+// the first double in size, as the arena fills up.
+//
+// Allocation is locked, so pool workers can share an arena. After a
+// reset() the first block grows to the high-water mark, so an arena that
+// is reused, like scratch(), settles into a single block.
+
+class Arena: public MemoryResource {
+public:
+    explicit Arena(std::string name, size_t initialBytes = 64 * 1024)
+        : m_name(std::move(name))
+        , m_buffer(initialBytes)
+    {
+        startRound();
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // Per thread, for buffers that do not outlive the call making them
+    static Arena &scratch() {
+        thread_local Arena arena("scratch");
+        return arena;
+    }
+
+    // Resets the arena when the outermost scope on it ends
+    class Scope {
+    public:
+        explicit Scope(Arena &arena)
+            : m_arena(arena)
+        {
+            m_arena.m_scopes++;
+        }
+
+        ~Scope() {
+            if (--m_arena.m_scopes == 0)
+                m_arena.reset();
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        operator MemoryResource *() const { return &m_arena; }
+
+    private:
+        Arena &m_arena;
+    };
+
+    // Everything handed out is gone after this
+    void reset() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_roundBytes > m_buffer.size())
+            m_buffer = std::vector<std::byte>(m_roundBytes);
+
+        startRound();
+        m_usedBytes = 0;
+        m_roundBytes = 0;
+    }
+
+    const std::string &name() const { return m_name; }
+
+    // Requested since the last reset, alignment padding aside
+    size_t usedBytes() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_usedBytes;
+    }
+
+    // Most ever in use at once
+    size_t highWater() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_highWater;
+    }
+
+    // Since the arena was made
+    size_t allocationCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_allocations;
+    }
+
+    void print() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        printf("[arena] %-16s %9zu bytes in use, %9zu high water, %7zu allocations\n",
+               m_name.c_str(), m_usedBytes, m_highWater, m_allocations);
+    }
+
+private:
+    void *doAllocate(size_t bytes, size_t alignment) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_usedBytes += bytes;
+        m_roundBytes += bytes + alignment;
+        m_allocations++;
+
+        if (m_usedBytes > m_highWater)
+            m_highWater = m_usedBytes;
+
+        if (auto p = bump(bytes, alignment))
+            return p;
+
+        m_nextBlockBytes = std::max(m_nextBlockBytes * 2, bytes + alignment);
+        m_blocks.emplace_back(m_nextBlockBytes);
+        startBlock(m_blocks.back());
+
+        return bump(bytes, alignment);
+    }
+
+    void doDeallocate(void *, size_t, size_t) override { }
+
+    // Back to the first block, the others go
+    void startRound() {
+        m_blocks.clear();
+        m_nextBlockBytes = m_buffer.size();
+        startBlock(m_buffer);
+    }
+
+    void startBlock(std::vector<std::byte> &block) {
+        m_top = (uintptr_t)block.data();
+        m_end = m_top + block.size();
+    }
+
+    void *bump(size_t bytes, size_t alignment) {
+        auto start = (m_top + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+        if (start > m_end || m_end - start < bytes)
+            return nullptr;
+
+        m_top = start + bytes;
+        return (void *)start;
+    }
+
+    std::string m_name;
+    mutable std::mutex m_mutex;
+
+    std::vector<std::byte> m_buffer;
+    std::vector<std::vector<std::byte>> m_blocks;   // past the first, until the next reset
+    size_t m_nextBlockBytes = 0;
+    uintptr_t m_top = 0;
+    uintptr_t m_end = 0;
+    int m_scopes = 0;
+
+    size_t m_usedBytes = 0;
+    size_t m_roundBytes = 0;    // with worst case padding, to size the next first block
+    size_t m_highWater = 0;
+    size_t m_allocations = 0;
+};
@@ -0,0 +1,200 @@
+//
+//  BillboardBatch.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "CourseSprites.h"
+
+// Camera facing quads, textured from the CourseSprites atlas
+struct BillboardQuads {
+    std::vector<float> vertices;    // 4 corners of x, y, z per quad
+    std::vector<float> texcoords;   // 4 corners of u, v per quad
+
+    int count() const {
+        return (int)vertices.size() / 12;
+    }
+};
+
+// Every billboard of a scene in one world space buffer, turned into quads
+// for a camera the way DrawBillboard would: right from the view, up along
+// the world Y. They come out back to front for blending, but the order is
+// only sorted again once the camera has moved ResortDistance away from
+// where it was last sorted.
+//
+// What the quads need of the sprites is copied in, so build() can run on a
+// pool worker while the scene is swapped out.
+
+class BillboardBatch {
+public:
+    static constexpr float ResortDistance = .25f;
+
+    void clear() {
+        m_instances.clear();
+        m_sprites.clear();
+        m_order.clear();
+        m_sorted = false;
+    }
+
+    // center is the middle of the billboard, in world space
+    void add(Vector3 center, const CourseSprites::Sprite &sprite) {
+        if (sprite.index >= m_sprites.size())
+            m_sprites.resize(sprite.index + 1);
+
+        auto &levels = m_sprites[sprite.index];
+
+        if (levels.levels.empty()) {
+            levels.levelFrom = sprite.levelFrom;
+
+            for (auto &level : sprite.levels)
+                levels.levels.push_back({ (float)level.height() / level.width(), level.atlasRect() });
+        }
+
+        m_instances.push_back({ center, sprite.width, sprite.index });
+        m_sorted = false;
+    }
+
+    int size() const {
+        return (int)m_instances.size();
+    }
+
+    void build(const Camera &camera, BillboardQuads &out) {
+        if (!m_sorted || Vector3Distance(camera.position, m_sortedFrom) > ResortDistance)
+            sort(camera.position);
+
+        auto view = MatrixLookAt(camera.position, camera.target, camera.up);
+        auto right = Vector3 { view.m0, view.m4, view.m8 };
+        auto up = Vector3 { 0, 1, 0 };
+        auto forward = Vector3Normalize(Vector3Subtract(camera.target, camera.position));
+
+        // sized for all of them, trimmed to what was written
+        out.vertices.resize(m_instances.size() * 12);
+        out.texcoords.resize(m_instances.size() * 8);
+
+        auto vertex = out.vertices.data();
+        auto texcoord = out.texcoords.data();
+
+        for (auto i : m_order) {
+            auto &instance = m_instances[i];
+            auto toSprite = Vector3Subtract(instance.center, camera.position);
+
+            // wholly behind the camera
+            if (Vector3DotProduct(toSprite, forward) < -instance.width)
+                continue;
+
+            auto &sprite = m_sprites[instance.sprite];
+            auto &level = sprite.levels[CourseSprites::LevelIndex(sprite.levelFrom, Vector3Length(toSprite))];
+
+            auto x = Vector3Scale(right, instance.width / 2);
+            auto y = Vector3Scale(up, instance.width * level.aspect / 2);
+            auto &c = instance.center;
+            auto &uv = level.uv;
+
+            float corners[12] = {
+                c.x - x.x + y.x,  c.y - x.y + y.y,  c.z - x.z + y.z,
+                c.x - x.x - y.x,  c.y - x.y - y.y,  c.z - x.z - y.z,
+                c.x + x.x - y.x,  c.y + x.y - y.y,  c.z + x.z - y.z,
+                c.x + x.x + y.x,  c.y + x.y + y.y,  c.z + x.z + y.z,
+            };
+
+            float uvs[8] = {
+                uv.x,            uv.y,
+                uv.x,            uv.y + uv.height,
+                uv.x + uv.width, uv.y + uv.height,
+                uv.x + uv.width, uv.y,
+            };
+
+            memcpy(vertex, corners, sizeof(corners));
+            memcpy(texcoord, uvs, sizeof(uvs));
+
+            vertex += 12;
+            texcoord += 8;
+        }
+
+        out.vertices.resize(vertex - out.vertices.data());
+        out.texcoords.resize(texcoord - out.texcoords.data());
+    }
+
+private:
+    struct Instance {
+        Vector3 center;
+        float width;
+        int sprite;
+    };
+
+    struct Level {
+        float aspect;       // height over width
+        Rectangle uv;
+    };
+
+    struct SpriteLevels {
+        std::vector<float> levelFrom;
+        std::vector<Level> levels;
+    };
+
+    // Farthest first. Keys sit next to the indices, since an indirect
+    // compare costs more than the sort itself. After a short move the
+    // previous order is nearly right, and an insertion sort over it only
+    // does the few swaps needed.
+    void sort(Vector3 from) {
+        auto resort = m_sorted && m_keys.size() == m_instances.size();
+
+        if (!resort) {
+            m_keys.resize(m_instances.size());
+
+            for (int i = 0; i < m_keys.size(); i++)
+                m_keys[i].second = i;
+        }
+
+        for (auto &key : m_keys) {
+            auto d = Vector3Subtract(m_instances[key.second].center, from);
+            key.first = Vector3DotProduct(d, d);
+        }
+
+        auto farther = [](auto &a, auto &b) {
+            return a.first > b.first;
+        };
+
+        if (resort) {
+            for (int i = 1; i < m_keys.size(); i++) {
+                auto key = m_keys[i];
+                int j = i;
+
+                for (; j > 0 && farther(key, m_keys[j - 1]); j--)
+                    m_keys[j] = m_keys[j - 1];
+
+                m_keys[j] = key;
+            }
+        }
+        else {
+            std::sort(m_keys.begin(), m_keys.end(), farther);
+        }
+
+        m_order.resize(m_keys.size());
+
+        for (int i = 0; i < m_keys.size(); i++)
+            m_order[i] = m_keys[i].second;
+
+        m_sortedFrom = from;
+        m_sorted = true;
+    }
+
+    std::vector<Instance> m_instances;
+    std::vector<SpriteLevels> m_sprites;    // by sprite index
+
+    std::vector<std::pair<float, int>> m_keys;
+    std::vector<int> m_order;
+    Vector3 m_sortedFrom = { 0 };
+    bool m_sorted = false;
+};
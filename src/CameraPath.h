@@ -0,0 +1,273 @@
+//
+//  CameraPath.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Profiler.h"
+
+// A flight around the screens, one camera pose per frame, to play the very
+// same frames back on another build and compare what they cost.
+//
+// On disk: "TDCP", a version word and a frame count word, then 27 bytes a
+// frame, all little endian: position and target as floats, the screen, the
+// scene and whether the screen had a camera at all.
+
+struct CameraPath {
+    static const uint16_t Version = 2;
+    static const int FrameSize = 27;
+
+    struct Frame {
+        Vector3 position;
+        Vector3 target;
+        uint8_t screen;     // main's screen index, the key pressed minus one
+        uint8_t scene;      // index in Resources::trackNames()
+        bool hasCamera;     // if not, position and target mean nothing
+    };
+
+    std::vector<Frame> frames;
+
+    bool save(const std::string &path) const {
+        std::vector<uint8_t> data;
+        data.reserve(10 + frames.size() * FrameSize);
+
+        for (auto c : { 'T', 'D', 'C', 'P' })
+            data.push_back(c);
+
+        putWord(data, Version);
+        putDoubleWord(data, (uint32_t)frames.size());
+
+        for (auto &frame : frames) {
+            for (auto v : { frame.position.x, frame.position.y, frame.position.z,
+                            frame.target.x,   frame.target.y,   frame.target.z }) {
+                uint32_t bits;
+                memcpy(&bits, &v, sizeof(bits));
+                putDoubleWord(data, bits);
+            }
+
+            data.push_back(frame.screen);
+            data.push_back(frame.scene);
+            data.push_back(frame.hasCamera);
+        }
+
+        auto file = fopen(path.c_str(), "wb");
+
+        if (!file)
+            return false;
+
+        auto written = fwrite(data.data(), 1, data.size(), file);
+        fclose(file);
+
+        return written == data.size();
+    }
+
+    static std::optional<CameraPath> load(const std::string &path) {
+        auto file = fopen(path.c_str(), "rb");
+
+        if (!file)
+            return {};
+
+        std::vector<uint8_t> data;
+        uint8_t buffer[4096];
+
+        while (auto length = fread(buffer, 1, sizeof(buffer), file))
+            data.insert(data.end(), buffer, buffer + length);
+
+        fclose(file);
+
+        if (data.size() < 10 || memcmp(data.data(), "TDCP", 4) != 0 || word(data, 4) != Version)
+            return {};
+
+        auto count = doubleWord(data, 6);
+
+        if (data.size() != 10 + (size_t)count * FrameSize)
+            return {};
+
+        CameraPath result;
+        result.frames.resize(count);
+
+        size_t i = 10;
+
+        for (auto &frame : result.frames) {
+            for (auto v : { &frame.position.x, &frame.position.y, &frame.position.z,
+                            &frame.target.x,   &frame.target.y,   &frame.target.z }) {
+                auto bits = doubleWord(data, i);
+                memcpy(v, &bits, sizeof(bits));
+                i += 4;
+            }
+
+            frame.screen = data[i++];
+            frame.scene = data[i++];
+            frame.hasCamera = data[i++] != 0;
+        }
+
+        return result;
+    }
+
+private:
+    static void putWord(std::vector<uint8_t> &data, uint16_t value) {
+        data.push_back(value & 0xff);
+        data.push_back(value >> 8);
+    }
+
+    static void putDoubleWord(std::vector<uint8_t> &data, uint32_t value) {
+        putWord(data, value & 0xffff);
+        putWord(data, value >> 16);
+    }
+
+    static uint16_t word(const std::vector<uint8_t> &data, size_t i) {
+        return (uint16_t)(data[i] | (data[i + 1] << 8));
+    }
+
+    static uint32_t doubleWord(const std::vector<uint8_t> &data, size_t i) {
+        return word(data, i) | ((uint32_t)word(data, i + 2) << 16);
+    }
+};
+
+// Plays a path back and gathers, for every frame, the time of each
+// Profiler section and the draw counters. The window is not capped to a
+// frame rate meanwhile, so the times are what the frames cost.
+
+class CameraPathReplay {
+public:
+    explicit CameraPathReplay(CameraPath path)
+        : m_path(std::move(path))
+    { }
+
+    bool done() const {
+        return m_next >= m_path.frames.size();
+    }
+
+    // The pose to apply before drawing the next frame
+    const CameraPath::Frame &frame() const {
+        return m_path.frames[m_next];
+    }
+
+    // After Profiler::endFrame()
+    void frameDone(const Profiler &profiler) {
+        profiler.visitLastFrame([this](const char *name, float milliseconds) {
+            samplesNamed(name).push_back(milliseconds);
+        });
+
+        for (int i = 0; i < Profiler::CounterCount; i++)
+            m_counters[i] += profiler.lastFrameCount((Profiler::Counter)i);
+
+        m_next++;
+    }
+
+    // Percentiles of every section, "frame" first, then how the frame
+    // times spread over buckets doubling in width
+    void print() const {
+        auto frames = (int)m_next;
+
+        if (frames == 0)
+            return;
+
+        printf("[replay] %d frames\n", frames);
+        printf("[replay] %-18s %7s %7s %7s %7s %7s %7s\n", "SECTION MS", "MIN", "P50", "P95", "P99", "MAX", "AVG");
+
+        const Samples *frameTimes = nullptr;
+
+        for (auto &section : m_sections) {
+            if (strcmp(section.first, "frame") == 0)
+                frameTimes = &section;
+        }
+
+        if (frameTimes)
+            printSection(*frameTimes, frames);
+
+        for (auto &section : m_sections) {
+            if (&section != frameTimes)
+                printSection(section, frames);
+        }
+
+        for (int i = 0; i < Profiler::CounterCount; i++)
+            printf("[replay] %-18s %7lld per frame\n", Profiler::CounterName(i), m_counters[i] / frames);
+
+        if (frameTimes)
+            printHistogram(frameTimes->second);
+    }
+
+private:
+    using Samples = std::pair<const char *, std::vector<float>>;
+
+    std::vector<float> &samplesNamed(const char *name) {
+        for (auto &section : m_sections) {
+            if (section.first == name || strcmp(section.first, name) == 0)
+                return section.second;
+        }
+
+        // a section first seen late spent nothing in the frames before
+        m_sections.push_back({ name, std::vector<float>(m_next, 0) });
+        return m_sections.back().second;
+    }
+
+    static void printSection(const Samples &section, int frames) {
+        auto sorted = section.second;
+        std::sort(sorted.begin(), sorted.end());
+
+        auto percentile = [&](int p) {
+            return sorted[std::min(sorted.size() - 1, sorted.size() * p / 100)];
+        };
+
+        float total = 0;
+        for (auto value : sorted)
+            total += value;
+
+        printf("[replay] %-18s %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f\n",
+               section.first, sorted.front(), percentile(50), percentile(95), percentile(99),
+               sorted.back(), total / frames);
+    }
+
+    static void printHistogram(const std::vector<float> &times) {
+        const int Buckets = 10;
+        const float FirstBucket = .5f;
+        const int BarWidth = 40;
+
+        int counts[Buckets] = { 0 };
+
+        for (auto time : times) {
+            auto bucket = 0;
+            auto limit = FirstBucket;
+
+            while (bucket < Buckets - 1 && time >= limit) {
+                bucket++;
+                limit *= 2;
+            }
+
+            counts[bucket]++;
+        }
+
+        auto most = *std::max_element(counts, counts + Buckets);
+        auto limit = FirstBucket;
+
+        for (int i = 0; i < Buckets; i++, limit *= 2) {
+            char bar[BarWidth + 1] = { 0 };
+            memset(bar, '#', counts[i] * BarWidth / most);
+
+            if (i < Buckets - 1)
+                printf("[replay] frame < %6.1f ms %6d %s\n", limit, counts[i], bar);
+            else
+                printf("[replay] frame >=%6.1f ms %6d %s\n", limit / 2, counts[i], bar);
+        }
+    }
+
+    CameraPath m_path;
+    size_t m_next = 0;
+    std::vector<Samples> m_sections;
+    long long m_counters[Profiler::CounterCount] = { 0 };
+};
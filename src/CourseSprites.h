@@ -0,0 +1,355 @@
+//
+//  CourseSprites.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "barfs.h"
+#include "GpuResources.h"
+#include "MemoryReport.h"
+
+// The billboard bitmaps of a scene, with every scaled copy the game would
+// build prepared once up front. Pure CPU work until a level's texture is
+// first asked for. Every level is also packed into one atlas, so all the
+// billboards of a scene can be drawn with a single texture.
+//
+// Levels keep the columns and rows init_rol_buffer's masks select:
+// columns by the first 7 mask bytes, rows by the 3 at 0x1b that
+// single_course_data_element_inner_2 rotates. That is a reading of the
+// masks, not a port, since the routine itself is not reversed yet.
+
+class CourseSprites {
+public:
+    // Width in world units of one pixel of a full size sprite
+    static constexpr float WorldUnitsPerPixel = 1 / 128.f;
+
+    // Distance at which a full size level is drawn pixel for pixel
+    static constexpr float FullSizeDistance = .5f;
+
+    // Wide enough for every stock sprite, doubled for any wider level
+    static constexpr int AtlasWidth = 256;
+
+    class Level {
+    public:
+        int width() const  { return m_width; }
+        int height() const { return m_height; }
+
+        // Fraction of the element's width this level keeps
+        float scale() const { return m_scale; }
+
+        Image image() {
+            return (Image) {
+                .data = &m_bitmap[0],
+                .width = m_width,
+                .height = m_height,
+                .mipmaps = 1,
+                .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+            };
+        }
+
+        // Where the level is in the atlas, in texture coordinates
+        Rectangle atlasRect() const { return m_atlasRect; }
+
+        // Main thread only
+        Texture2D texture() {
+            if (!m_texture) {
+                TD_PROFILE_SCOPE("texture upload");
+                m_texture.emplace(image());
+            }
+
+            Profiler::shared().count(Profiler::TextureBinds);
+            return m_texture->texture();
+        }
+
+    private:
+        friend class CourseSprites;
+
+        int m_width = 0;
+        int m_height = 0;
+        float m_scale = 1;
+        Rectangle m_atlasRect = { 0 };
+        std::vector<TD::Color> m_bitmap;
+        std::optional<GpuTexture> m_texture;
+    };
+
+    struct Sprite {
+        int index;
+        float width;        // world units, at full size
+        float height;
+
+        // Nearest level first; the distance each one takes over from
+        std::vector<Level> levels;
+        std::vector<float> levelFrom;
+    };
+
+    CourseSprites(const TD::Scene &scene, const TD::GamePalette &palette) {
+        auto elements = TD::CourseDataDecoder(scene).decode();
+
+        m_sprites.resize(elements.size() + 1);
+
+        for (auto &element : elements) {
+            auto &sprite = m_sprites[element.index];
+
+            sprite.index = element.index;
+            sprite.width = element.width * WorldUnitsPerPixel;
+            sprite.height = element.height * WorldUnitsPerPixel;
+
+            buildLevels(sprite, element, palette);
+        }
+
+        buildAtlas();
+    }
+
+    // Sprite::a & 0x1f
+    const Sprite *sprite(int index) const {
+        if (index <= 0 || index >= m_sprites.size() || m_sprites[index].levels.empty())
+            return nullptr;
+
+        return &m_sprites[index];
+    }
+
+    Level &level(const Sprite &sprite, float distance) {
+        return m_sprites[sprite.index].levels[LevelIndex(sprite.levelFrom, distance)];
+    }
+
+    Level &level(int sprite, int level) {
+        return m_sprites[sprite].levels[level];
+    }
+
+    // Index of the level to draw at distance, given a Sprite::levelFrom
+    static int LevelIndex(const std::vector<float> &levelFrom, float distance) {
+        int i = 0;
+        while (i + 1 < levelFrom.size() && distance >= levelFrom[i + 1])
+            i++;
+
+        return i;
+    }
+
+    int levelCount() const {
+        int count = 0;
+
+        for (auto &sprite : m_sprites)
+            count += (int)sprite.levels.size();
+
+        return count;
+    }
+
+    int atlasWidth() const {
+        return m_atlasWidth;
+    }
+
+    int atlasHeight() const {
+        return m_atlasHeight;
+    }
+
+    Image atlasImage() {
+        return (Image) {
+            .data = &m_atlas[0],
+            .width = m_atlasWidth,
+            .height = m_atlasHeight,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+        };
+    }
+
+    // Main thread only
+    Texture2D atlasTexture() {
+        if (!m_atlasTexture) {
+            TD_PROFILE_SCOPE("texture upload");
+            m_atlasTexture.emplace(atlasImage());
+        }
+
+        Profiler::shared().count(Profiler::TextureBinds);
+        return m_atlasTexture->texture();
+    }
+
+    void accountMemory(MemoryReport &report, const std::string &subsystem) const {
+        for (auto &sprite : m_sprites) {
+            if (sprite.levels.empty())
+                continue;
+
+            char name[32];
+            snprintf(name, sizeof(name), "sprite %d", sprite.index);
+
+            for (auto &level : sprite.levels) {
+                report.add(subsystem, name, MemoryReport::Kind::Decoded, level.m_bitmap.size() * sizeof(TD::Color));
+                report.add(subsystem, name, MemoryReport::Kind::Gpu, level.m_texture ? level.m_texture->bytes() : 0);
+            }
+        }
+
+        report.add(subsystem, "sprite atlas", MemoryReport::Kind::Decoded, m_atlas.size() * sizeof(TD::Color));
+        report.add(subsystem, "sprite atlas", MemoryReport::Kind::Gpu, m_atlasTexture ? m_atlasTexture->bytes() : 0);
+    }
+
+private:
+    void buildLevels(Sprite &sprite, const TD::CourseDataElement &element, const TD::GamePalette &palette) {
+        if (element.width == 0 || element.height == 0)
+            return;
+
+        // mode 1 elements get no scaled copies in the game, draw them as they are
+        if (element.levels.empty()) {
+            sprite.levels.push_back(fullSize(element, palette));
+            sprite.levelFrom.push_back(0);
+            return;
+        }
+
+        for (auto &courseLevel : element.levels) {
+            auto level = scaled(element, courseLevel, palette);
+
+            if (level.m_width > 0 && level.m_height > 0)
+                sprite.levels.push_back(std::move(level));
+        }
+
+        // the steps past 0x17 do not come out bigger, so order by size
+        std::stable_sort(sprite.levels.begin(), sprite.levels.end(), [](auto &a, auto &b) {
+            return a.m_scale > b.m_scale;
+        });
+
+        for (auto &level : sprite.levels) {
+            auto from = sprite.levelFrom.empty() ? 0 : FullSizeDistance / level.m_scale;
+            sprite.levelFrom.push_back(from);
+        }
+    }
+
+    static Level fullSize(const TD::CourseDataElement &element, const TD::GamePalette &palette) {
+        std::vector<int> columns, rows;
+
+        for (int x = 0; x < element.width; x++)  columns.push_back(x);
+        for (int y = 0; y < element.height; y++) rows.push_back(y);
+
+        return resample(element, columns, rows, 1, palette);
+    }
+
+    static Level scaled(const TD::CourseDataElement &element,
+                        const TD::CourseDataLevel &level,
+                        const TD::GamePalette &palette)
+    {
+        auto bit = [](uint8_t byte, int i) {
+            return (byte >> (7 - (i & 7))) & 1;
+        };
+
+        std::vector<int> columns, rows;
+
+        for (int x = 0; x < element.width; x++) {
+            if (bit(level.rolMasks[(x / 8) % 7], x))
+                columns.push_back(x);
+        }
+
+        for (int y = 0; y < element.height; y++) {
+            if (bit(level.rolMasks[0x1b + (y / 8) % 3], y))
+                rows.push_back(y);
+        }
+
+        return resample(element, columns, rows, 1 << level.doublings, palette);
+    }
+
+    static Level resample(const TD::CourseDataElement &element,
+                          const std::vector<int> &columns,
+                          const std::vector<int> &rows,
+                          int repeat,
+                          const TD::GamePalette &palette)
+    {
+        Level level;
+        level.m_width  = (int)columns.size() * repeat;
+        level.m_height = (int)rows.size() * repeat;
+        level.m_scale  = (float)level.m_width / element.width;
+        level.m_bitmap.resize(level.m_width * level.m_height);
+
+        for (int y = 0; y < level.m_height; y++) {
+            for (int x = 0; x < level.m_width; x++) {
+                auto index = element.pixel(columns[x / repeat], rows[y / repeat]);
+
+                auto color = palette.get(index);
+                color.a = index ? 0xff : 0;
+
+                level.m_bitmap[y * level.m_width + x] = color;
+            }
+        }
+
+        return level;
+    }
+
+    // Shelves of the tallest levels first, a transparent pixel apart
+    void buildAtlas() {
+        std::vector<Level *> levels;
+
+        for (auto &sprite : m_sprites) {
+            for (auto &level : sprite.levels)
+                levels.push_back(&level);
+        }
+
+        std::stable_sort(levels.begin(), levels.end(), [](auto a, auto b) {
+            return a->m_height > b->m_height;
+        });
+
+        m_atlasWidth = AtlasWidth;
+
+        for (auto level : levels) {
+            while (level->m_width > m_atlasWidth)
+                m_atlasWidth *= 2;
+        }
+
+        if (m_atlasWidth != AtlasWidth)
+            printf("[sprites] a level is wider than %d pixels, atlas grown to %d\n", AtlasWidth, m_atlasWidth);
+
+        std::vector<std::pair<int, int>> origins;
+        int x = 0, y = 0, shelf = 0;
+
+        for (auto level : levels) {
+            if (x + level->m_width > m_atlasWidth) {
+                x = 0;
+                y += shelf;
+                shelf = 0;
+            }
+
+            origins.push_back({ x, y });
+
+            x += level->m_width + 1;
+
+            if (level->m_height + 1 > shelf)
+                shelf = level->m_height + 1;
+        }
+
+        m_atlasHeight = 1;
+        while (m_atlasHeight < y + shelf)
+            m_atlasHeight *= 2;
+
+        m_atlas.assign(m_atlasWidth * m_atlasHeight, TD::Color { 0 });
+
+        for (int i = 0; i < levels.size(); i++) {
+            auto level = levels[i];
+            auto [left, top] = origins[i];
+
+            for (int row = 0; row < level->m_height; row++) {
+                std::copy_n(&level->m_bitmap[row * level->m_width],
+                            level->m_width,
+                            &m_atlas[(top + row) * m_atlasWidth + left]);
+            }
+
+            level->m_atlasRect = {
+                (float)left / m_atlasWidth,
+                (float)top / m_atlasHeight,
+                (float)level->m_width / m_atlasWidth,
+                (float)level->m_height / m_atlasHeight,
+            };
+        }
+    }
+
+    std::vector<Sprite> m_sprites;
+
+    int m_atlasWidth = AtlasWidth;
+    int m_atlasHeight = 0;
+    std::vector<TD::Color> m_atlas;
+    std::optional<GpuTexture> m_atlasTexture;
+};
@@ -0,0 +1,307 @@
+//
+//  Culling.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <rlgl.h>
+
+#include <cfloat>
+#include <vector>
+
+inline BoundingBox EmptyBoundingBox() {
+    return {
+        .min = {  FLT_MAX,  FLT_MAX,  FLT_MAX },
+        .max = { -FLT_MAX, -FLT_MAX, -FLT_MAX },
+    };
+}
+
+inline bool IsBoundingBoxEmpty(const BoundingBox &box) {
+    return box.min.x > box.max.x;
+}
+
+inline void ExpandBoundingBox(BoundingBox &box, Vector3 point) {
+    box.min.x = fminf(box.min.x, point.x);
+    box.min.y = fminf(box.min.y, point.y);
+    box.min.z = fminf(box.min.z, point.z);
+
+    box.max.x = fmaxf(box.max.x, point.x);
+    box.max.y = fmaxf(box.max.y, point.y);
+    box.max.z = fmaxf(box.max.z, point.z);
+}
+
+inline void ExpandBoundingBox(BoundingBox &box, const BoundingBox &other) {
+    if (IsBoundingBoxEmpty(other))
+        return;
+
+    ExpandBoundingBox(box, other.min);
+    ExpandBoundingBox(box, other.max);
+}
+
+inline BoundingBox TransformBoundingBox(const BoundingBox &box, const Matrix &transform) {
+    auto result = EmptyBoundingBox();
+
+    if (IsBoundingBoxEmpty(box))
+        return result;
+
+    for (int i = 0; i < 8; i++) {
+        Vector3 corner = {
+            (i & 1) ? box.max.x : box.min.x,
+            (i & 2) ? box.max.y : box.min.y,
+            (i & 4) ? box.max.z : box.min.z,
+        };
+
+        ExpandBoundingBox(result, Vector3Transform(corner, transform));
+    }
+
+    return result;
+}
+
+// Same composition DrawModelEx uses: rotate around Y, then translate.
+inline Matrix PlacementTransform(Vector3 position, float angleDegrees) {
+    return MatrixMultiply(MatrixRotate({ 0, 1, 0 }, angleDegrees * DEG2RAD),
+                          MatrixTranslate(position.x, position.y, position.z));
+}
+
+class Frustum {
+public:
+    enum Result {
+        Outside,
+        Intersecting,
+        Inside,
+    };
+
+    // Matches the projection BeginMode3D sets up for a perspective camera
+    Frustum(const Camera &camera, float aspect) {
+        auto view = MatrixLookAt(camera.position, camera.target, camera.up);
+        auto projection = MatrixPerspective(camera.fovy * DEG2RAD,
+                                            aspect,
+                                            RL_CULL_DISTANCE_NEAR,
+                                            RL_CULL_DISTANCE_FAR);
+
+        auto m = MatrixMultiply(view, projection);
+
+        Vector4 row0 = { m.m0, m.m4, m.m8,  m.m12 };
+        Vector4 row1 = { m.m1, m.m5, m.m9,  m.m13 };
+        Vector4 row2 = { m.m2, m.m6, m.m10, m.m14 };
+        Vector4 row3 = { m.m3, m.m7, m.m11, m.m15 };
+
+        m_planes[0] = normalize(add(row3, row0));  // left
+        m_planes[1] = normalize(sub(row3, row0));  // right
+        m_planes[2] = normalize(add(row3, row1));  // bottom
+        m_planes[3] = normalize(sub(row3, row1));  // top
+        m_planes[4] = normalize(add(row3, row2));  // near
+        m_planes[5] = normalize(sub(row3, row2));  // far
+    }
+
+    Result test(const BoundingBox &box) const {
+        auto result = Inside;
+
+        for (auto &p : m_planes) {
+            // farthest corner along the plane normal, then the nearest one
+            Vector3 positive = {
+                p.x >= 0 ? box.max.x : box.min.x,
+                p.y >= 0 ? box.max.y : box.min.y,
+                p.z >= 0 ? box.max.z : box.min.z,
+            };
+
+            Vector3 negative = {
+                p.x >= 0 ? box.min.x : box.max.x,
+                p.y >= 0 ? box.min.y : box.max.y,
+                p.z >= 0 ? box.min.z : box.max.z,
+            };
+
+            if (distance(p, positive) < 0)
+                return Outside;
+
+            if (distance(p, negative) < 0)
+                result = Intersecting;
+        }
+
+        return result;
+    }
+
+    bool isVisible(const BoundingBox &box) const {
+        return test(box) != Outside;
+    }
+
+private:
+    static Vector4 add(Vector4 a, Vector4 b) { return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+    static Vector4 sub(Vector4 a, Vector4 b) { return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+
+    static Vector4 normalize(Vector4 p) {
+        auto length = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+        return { p.x / length, p.y / length, p.z / length, p.w / length };
+    }
+
+    static float distance(const Vector4 &p, const Vector3 &v) {
+        return p.x * v.x + p.y * v.y + p.z * v.z + p.w;
+    }
+
+    Vector4 m_planes[6];
+};
+
+struct CullingStats {
+    int visibleCells;
+    int culledCells;
+    int visibleTiles;
+    int culledTiles;
+    int visibleObjects;
+    int culledObjects;
+    int occludedCells;
+    int occludedTiles;
+    int occludedObjects;
+};
+
+// Two level grid over the tile map: coarse cells of CellSize x CellSize
+// tiles, each holding the world bounds of its tiles and of the objects
+// whose origin falls inside it.
+//
+// Culling tests a cell against the frustum and then, optionally, against
+// an occlusion test (an OcclusionBuffer); what is left of a cell is tested
+// the same way, tile by tile and object by object. Culled counts are what
+// the frustum removed, occluded ones what it kept but the test hid.
+
+class SceneGrid {
+public:
+    static const int CellSize = 4;
+
+    SceneGrid(int xTileCount, int yTileCount)
+        : m_xTileCount(xTileCount)
+        , m_yTileCount(yTileCount)
+        , m_xCellCount((xTileCount + CellSize - 1) / CellSize)
+        , m_yCellCount((yTileCount + CellSize - 1) / CellSize)
+        , m_cells(m_xCellCount * m_yCellCount)
+        , m_tileBounds(xTileCount * yTileCount, EmptyBoundingBox())
+    {
+        for (auto &cell : m_cells)
+            cell.bounds = EmptyBoundingBox();
+    }
+
+    void addTile(int tileX, int tileY, const BoundingBox &bounds) {
+        m_tileBounds[tileY * m_xTileCount + tileX] = bounds;
+        ExpandBoundingBox(cellAt(tileX, tileY).bounds, bounds);
+    }
+
+    void addObject(int index, const BoundingBox &bounds) {
+        if (IsBoundingBoxEmpty(bounds))
+            return;
+
+        auto center = Vector3Scale(Vector3Add(bounds.min, bounds.max), .5f);
+
+        auto tileX = (int)Clamp(roundf(center.x), 0, m_xTileCount - 1);
+        auto tileY = (int)Clamp(roundf(center.z), 0, m_yTileCount - 1);
+
+        auto &cell = cellAt(tileX, tileY);
+        cell.objects.push_back({ index, bounds });
+        ExpandBoundingBox(cell.bounds, bounds);
+    }
+
+    const BoundingBox &tileBounds(int tileX, int tileY) const {
+        return m_tileBounds[tileY * m_xTileCount + tileX];
+    }
+
+    struct NoOcclusion {
+        bool isVisible(const BoundingBox &) const { return true; }
+    };
+
+    template <typename TileVisitor, typename ObjectVisitor>
+    CullingStats cull(const Frustum &frustum, TileVisitor visitTile, ObjectVisitor visitObject) const {
+        return cull(frustum, NoOcclusion(), visitTile, visitObject);
+    }
+
+    template <typename Occlusion, typename TileVisitor, typename ObjectVisitor>
+    CullingStats cull(const Frustum &frustum, const Occlusion &occlusion,
+                      TileVisitor visitTile, ObjectVisitor visitObject) const
+    {
+        CullingStats stats = { 0 };
+
+        for (int cy = 0; cy < m_yCellCount; cy++) {
+            for (int cx = 0; cx < m_xCellCount; cx++) {
+                auto &cell = m_cells[cy * m_xCellCount + cx];
+
+                auto x0 = cx * CellSize;
+                auto y0 = cy * CellSize;
+                auto x1 = x0 + CellSize < m_xTileCount ? x0 + CellSize : m_xTileCount;
+                auto y1 = y0 + CellSize < m_yTileCount ? y0 + CellSize : m_yTileCount;
+                auto tileCount = (x1 - x0) * (y1 - y0);
+
+                auto cellResult = frustum.test(cell.bounds);
+
+                if (cellResult == Frustum::Outside) {
+                    stats.culledCells++;
+                    stats.culledTiles += tileCount;
+                    stats.culledObjects += (int)cell.objects.size();
+                    continue;
+                }
+
+                auto cellOccluded = !occlusion.isVisible(cell.bounds);
+
+                if (cellOccluded)
+                    stats.occludedCells++;
+                else
+                    stats.visibleCells++;
+
+                for (int y = y0; y < y1; y++) {
+                    for (int x = x0; x < x1; x++) {
+                        auto &bounds = tileBounds(x, y);
+
+                        if (cellResult != Frustum::Inside && !frustum.isVisible(bounds)) {
+                            stats.culledTiles++;
+                        }
+                        else if (cellOccluded || !occlusion.isVisible(bounds)) {
+                            stats.occludedTiles++;
+                        }
+                        else {
+                            stats.visibleTiles++;
+                            visitTile(x, y);
+                        }
+                    }
+                }
+
+                for (auto &object : cell.objects) {
+                    if (cellResult != Frustum::Inside && !frustum.isVisible(object.bounds)) {
+                        stats.culledObjects++;
+                    }
+                    else if (cellOccluded || !occlusion.isVisible(object.bounds)) {
+                        stats.occludedObjects++;
+                    }
+                    else {
+                        stats.visibleObjects++;
+                        visitObject(object.index);
+                    }
+                }
+            }
+        }
+
+        return stats;
+    }
+
+private:
+    struct CellObject {
+        int index;
+        BoundingBox bounds;
+    };
+
+    struct Cell {
+        BoundingBox bounds;
+        std::vector<CellObject> objects;
+    };
+
+    Cell &cellAt(int tileX, int tileY) {
+        return m_cells[(tileY / CellSize) * m_xCellCount + (tileX / CellSize)];
+    }
+
+    int m_xTileCount;
+    int m_yTileCount;
+    int m_xCellCount;
+    int m_yCellCount;
+
+    std::vector<Cell> m_cells;
+    std::vector<BoundingBox> m_tileBounds;
+};
@@ -8,25 +8,33 @@
 #pragma once
 
 #include <cstddef>
+#include <optional>
 #include <vector>
 
-static std::vector<std::byte> Decode(const std::vector<std::byte> &buf_src) {
-    std::vector<std::byte> buf_dst;
+#include "MemoryResource.h"
 
+// The output and the work buffers come from memory, a scratch arena is a
+// good fit as the results are only an intermediate step
+
+// Hands every decoded byte to emit, in order
+template <typename Emit>
+static void DecodeTo(const std::vector<std::byte> &buf_src, Emit &&emit,
+                     MemoryResource *memory = MemoryResource::heap())
+{
     const auto initial_src_idx = 0x400;
     auto top = std::min((int)buf_src.size(), initial_src_idx);
 
-    std::vector<std::byte> buf_private(&buf_src[0], &buf_src[top]);
+    ResourceVector<std::byte> buf_private(&buf_src[0], &buf_src[top], memory);
     for (int i = 0; i < initial_src_idx - top; i++)
         buf_private.push_back(std::byte(0));
 
     auto src_buf_idx = initial_src_idx;
 
-    std::vector<std::byte> buffer_14(0x300 * 16);
+    ResourceVector<std::byte> buffer_14(0x300 * 16, memory);
     uint16_t first_word_for_buffer_14 = 0;
     uint8_t  third_byte_for_buffer_14 = 0;
 
-    std::vector<std::byte> to_push;
+    ResourceVector<std::byte> to_push(memory);
 
     uint16_t boh_2 = 0;
     uint8_t byte_306AC = 0;
@@ -119,7 +127,7 @@ static std::vector<std::byte> Decode(const std::vector<std::byte> &buf_src) {
             first_word_for_buffer_14 = ax;
             third_byte_for_buffer_14 = ax & 0xff;
             byte_306AC = ax & 0xff;
-            buf_dst.push_back(std::byte(ax & 0xff));
+            emit(std::byte(ax & 0xff));
         }
         else {
             word_3069E = decode_internal_result;
@@ -147,7 +155,7 @@ static std::vector<std::byte> Decode(const std::vector<std::byte> &buf_src) {
             to_push.push_back(std::byte(al));
 
             while (!to_push.empty()) {
-                buf_dst.push_back(to_push.back());
+                emit(to_push.back());
                 to_push.pop_back();
             }
 
@@ -168,21 +176,26 @@ static std::vector<std::byte> Decode(const std::vector<std::byte> &buf_src) {
         }
     }
 
-    return buf_dst;
 }
 
-static std::vector<std::byte> RLEDecode(const std::vector<std::byte> &buf_src) {
-    std::vector<std::byte> buf_dst;
-    int i = 0;
+// The LZ stage gives colour and count pairs, expanded as they come rather
+// than kept as a stream of their own: only the pixels grow in the arena
+static ResourceVector<std::byte> DecodeImage(const std::vector<std::byte> &buf_src,
+                                             MemoryResource *memory = MemoryResource::heap())
+{
+    ResourceVector<std::byte> buf_dst(memory);
 
-    while (i < buf_src.size()) {
-        auto color = buf_src[i++];
-        auto count = buf_src[i++];
+    std::optional<std::byte> color;
 
-        for (int k = 0; k < std::to_integer<uint8_t>(count); k++) {
-            buf_dst.push_back(color);
+    DecodeTo(buf_src, [&](std::byte value) {
+        if (!color) {
+            color = value;
+            return;
         }
-    }
+
+        buf_dst.insert(buf_dst.end(), std::to_integer<uint8_t>(value), *color);
+        color.reset();
+    }, memory);
 
     return buf_dst;
 }
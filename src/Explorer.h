@@ -69,30 +69,29 @@ public:
         m_scale = value;
     }
 
-    void drawTitle() {
+    void drawTitle(RenderBackend &backend) {
         char sucaminchia[100];
         snprintf(sucaminchia, 100, "%03d of %03d", m_spinner.current(), m_spinner.size());
 
-        DrawText(m_title.c_str(), 30, 30, 30, BLUE);
-        DrawText(sucaminchia, 30, 60, 20, BLUE);
+        backend.drawText(m_title.c_str(), 30, 30, 30, BLUE);
+        backend.drawText(sucaminchia, 30, 60, 20, BLUE);
     }
 
-    void beginDrawingObject() {
-        ClearBackground(DARKGRAY);
-        BeginMode3D(m_camera);
+    void beginDrawingObject(RenderBackend &backend) {
+        backend.beginFrame(DARKGRAY);
+        backend.beginMode3D(m_camera);
 
-        DrawGrid(15, 1.0f);
-        rlPushMatrix();
-
-        rlScalef(m_scale, m_scale, m_scale);
-        rlRotatef(m_rotation++, 0, 1, 0);
+        backend.drawGrid(15, 1.0f);
+        backend.pushMatrix(MatrixMultiply(MatrixRotateY(m_rotation++ * DEG2RAD),
+                                          MatrixScale(m_scale, m_scale, m_scale)));
     }
 
-    void endDrawingObject() {
-        rlPopMatrix();
-        EndMode3D();
+    void endDrawingObject(RenderBackend &backend) {
+        backend.popMatrix();
+        backend.endMode3D();
 
-        drawTitle();
+        drawTitle(backend);
+        backend.endFrame();
     }
 
 private:
@@ -0,0 +1,153 @@
+//
+//  FileWatcher.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#define TD_FILEWATCHER_INOTIFY 1
+#else
+#define TD_FILEWATCHER_INOTIFY 0
+#endif
+
+#if !defined(__EMSCRIPTEN__)
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+// Names of the files of a directory written since the last poll(). Uses
+// inotify on Linux; elsewhere the directory is listed every PollInterval
+// and files are compared by size and modification time. Nothing is ever
+// reported on the web, where there is no one to edit the files.
+
+class FileWatcher {
+public:
+    static constexpr auto PollInterval = std::chrono::milliseconds(500);
+
+    explicit FileWatcher(std::string directory)
+        : m_directory(std::move(directory))
+    {
+#if TD_FILEWATCHER_INOTIFY
+        m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+        if (m_fd >= 0)
+            inotify_add_watch(m_fd, m_directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+#else
+        m_files = list();
+        m_lastPoll = std::chrono::steady_clock::now();
+#endif
+    }
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    ~FileWatcher() {
+#if TD_FILEWATCHER_INOTIFY
+        if (m_fd >= 0)
+            close(m_fd);
+#endif
+    }
+
+    // Never blocks; each name once, in no particular order
+    std::vector<std::string> poll() {
+        std::vector<std::string> changed;
+
+#if TD_FILEWATCHER_INOTIFY
+        alignas(inotify_event) char buffer[4096];
+
+        while (m_fd >= 0) {
+            auto length = read(m_fd, buffer, sizeof(buffer));
+
+            if (length <= 0)
+                break;
+
+            for (char *p = buffer; p < buffer + length;) {
+                auto event = (const inotify_event *)p;
+
+                if (event->len > 0)
+                    addOnce(changed, event->name);
+
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+#else
+        auto now = std::chrono::steady_clock::now();
+
+        if (now - m_lastPoll < PollInterval)
+            return changed;
+
+        m_lastPoll = now;
+
+        auto files = list();
+
+        for (auto &file : files) {
+            auto previous = m_files.find(file.first);
+
+            if (previous == m_files.end() || previous->second != file.second)
+                changed.push_back(file.first);
+        }
+
+        m_files = std::move(files);
+#endif
+
+        return changed;
+    }
+
+private:
+    static void addOnce(std::vector<std::string> &names, const std::string &name) {
+        for (auto &other : names) {
+            if (other == name)
+                return;
+        }
+
+        names.push_back(name);
+    }
+
+#if !TD_FILEWATCHER_INOTIFY
+    // size and modification time, by name
+    using Stamp = std::pair<long long, long long>;
+
+    std::map<std::string, Stamp> list() const {
+        std::map<std::string, Stamp> files;
+
+#if !defined(__EMSCRIPTEN__)
+        auto dir = opendir(m_directory.c_str());
+
+        if (!dir)
+            return files;
+
+        while (auto entry = readdir(dir)) {
+            struct stat info;
+            auto path = m_directory + "/" + entry->d_name;
+
+            if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+                continue;
+
+            files[entry->d_name] = { (long long)info.st_size, (long long)info.st_mtime };
+        }
+
+        closedir(dir);
+#endif
+
+        return files;
+    }
+
+    std::map<std::string, Stamp> m_files;
+    std::chrono::steady_clock::time_point m_lastPoll;
+#else
+    int m_fd = -1;
+#endif
+
+    std::string m_directory;
+};
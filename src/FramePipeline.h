@@ -0,0 +1,90 @@
+//
+//  FramePipeline.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#include "ThreadPool.h"
+
+// Two Frame buffers: while the main thread submits the current one, a pool
+// worker builds the next. The handoff is a single atomic flag; the main
+// thread only waits if the worker is still busy when it swaps.
+//
+// Jobs run on the pool, so they must not call into raylib. Without
+// threads the pool runs the build inline and nothing overlaps.
+
+template <typename Frame>
+class FramePipeline {
+public:
+    explicit FramePipeline(ThreadPool &pool = ThreadPool::shared())
+        : m_pool(pool)
+    { }
+
+    FramePipeline(const FramePipeline &) = delete;
+    FramePipeline &operator=(const FramePipeline &) = delete;
+
+    ~FramePipeline() {
+        wait();
+    }
+
+    bool isBuilding() const {
+        return m_building;
+    }
+
+    // Starts build(frame) on the back buffer; waits for any build still
+    // running first
+    template <typename Build>
+    void build(Build build) {
+        wait();
+
+        auto &frame = m_frames[1 - m_current];
+
+        m_building = true;
+        m_ready.store(false, std::memory_order_relaxed);
+
+        m_pool.submit([this, &frame, build = std::move(build)] {
+            build(frame);
+            m_ready.store(true, std::memory_order_release);
+        });
+    }
+
+    // Makes the frame being built the current one, once it is done
+    bool swap() {
+        if (!m_building)
+            return false;
+
+        wait();
+
+        m_current = 1 - m_current;
+        m_building = false;
+        return true;
+    }
+
+    // Until the next swap(), not written by anyone
+    const Frame &current() const {
+        return m_frames[m_current];
+    }
+
+    void wait() const {
+        if (!m_building)
+            return;
+
+        while (!m_ready.load(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+
+private:
+    ThreadPool &m_pool;
+
+    Frame m_frames[2];
+    int m_current = 0;
+    bool m_building = false;
+    std::atomic<bool> m_ready { true };
+};
@@ -7,7 +7,16 @@
 
 #pragma once
 
+#include "Arena.h"
 #include "Decoders.h"
+#include "GpuResources.h"
+#include "ImageScaler.h"
+#include "MemoryReport.h"
+
+#include <atomic>
+#include <map>
+#include <optional>
+#include <utility>
 
 namespace TD {
 
@@ -38,30 +47,57 @@ class GamePalette {
 public:
     GamePalette()
         : palette(0x100)
+        , m_id(NextId())
     {
         copy(DefaultPalette, 0);
     }
 
     GamePalette(const std::vector<std::byte> &data, int at)
         : palette(0x100)
+        , m_id(NextId())
     {
         auto palette = PaletteFromData(data);
         copy(DefaultPalette, 0);
         copy(palette, at);
     }
 
+    // Copies are separate palettes that may change independently
+    GamePalette(const GamePalette &other)
+        : palette(other.palette)
+        , m_id(NextId())
+    { }
+
+    GamePalette &operator=(const GamePalette &other) {
+        palette = other.palette;
+        m_version++;
+        return *this;
+    }
+
     void copy(std::vector<Color> src, int at) {
         for (int i = 0; i < src.size(); i++) {
             palette[at + i] = src[i];
         }
+
+        m_version++;
     }
 
     Color get(int at) const {
         return palette[at];
     }
 
+    // Identity and change counter, for caches of colours derived from it
+    int id()      const { return m_id; }
+    int version() const { return m_version; }
+
 private:
     std::vector<Color> palette;
+    int m_id;
+    int m_version = 0;
+
+    static int NextId() {
+        static std::atomic<int> next { 1 };
+        return next++;
+    }
 
     static std::vector<Color> PaletteFromData(const std::vector<std::byte> &data) {
         auto count = data.size() / 3;
@@ -79,14 +115,18 @@ private:
 
 };
 
+// The pixels never change once decoded, so one image can be shared, see
+// ImageCache. Its texture and scaled copies are made on the main thread
+// when first drawn, const or not, and go with the image when its last
+// holder lets go of it.
+
 class GameImage {
 public:
     GameImage(const std::vector<std::byte> &imageLz, int width, const GamePalette &palette, int colorBase = 0)
-        : m_textureLoaded(false)
-        , m_width(width)
+        : m_width(width)
     {
-        auto decoded    = Decode(imageLz);
-        auto bitmap8bpp = RLEDecode(decoded);
+        auto scratch    = Arena::Scope(Arena::scratch());
+        auto bitmap8bpp = DecodeImage(imageLz, scratch);
 
         m_height = static_cast<int>(bitmap8bpp.size()) / m_width;
 
@@ -104,9 +144,9 @@ public:
         }
     }
 
-    Image image() {
+    Image image() const {
         return (Image) {
-            .data = &m_bitmap[0],
+            .data = (void *)m_bitmap.data(),
             .width = m_width,
             .height = m_height,
             .mipmaps = 1,
@@ -114,26 +154,79 @@ public:
         };
     }
 
-    Texture2D texture() {
-        if (!m_textureLoaded) {
-            m_texture = LoadTextureFromImage(image());
-            m_textureLoaded = true;
+    Texture2D texture() const {
+        if (!m_texture) {
+            TD_PROFILE_SCOPE("texture upload");
+            m_texture.emplace(image());
         }
 
-        return m_texture;
+        Profiler::shared().count(Profiler::TextureBinds);
+        return m_texture->texture();
     }
 
-    void unloadTexture() {
-        if (m_textureLoaded)
-            UnloadTexture(m_texture);
+    // Upscaled copies, made on first use and kept per factor and filter
+    Image image(int factor, ImageScaler::Filter filter) const {
+        if (factor <= 1)
+            return image();
+
+        auto &scaled = scaledCopy(factor, filter);
+
+        return (Image) {
+            .data = (void *)scaled.bitmap.data(),
+            .width = m_width * factor,
+            .height = m_height * factor,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+        };
+    }
+
+    Texture2D texture(int factor, ImageScaler::Filter filter) const {
+        if (factor <= 1)
+            return texture();
+
+        auto &scaled = scaledCopy(factor, filter);
+
+        if (!scaled.texture) {
+            TD_PROFILE_SCOPE("texture upload");
+            scaled.texture.emplace(image(factor, filter));
+        }
+
+        Profiler::shared().count(Profiler::TextureBinds);
+        return scaled.texture->texture();
+    }
+
+    void accountMemory(MemoryReport &report, const std::string &subsystem, const std::string &asset) const {
+        report.add(subsystem, asset, MemoryReport::Kind::Decoded, m_bitmap.size() * sizeof(TD::Color));
+        report.add(subsystem, asset, MemoryReport::Kind::Gpu, m_texture ? m_texture->bytes() : 0);
+
+        for (auto &scaled : m_scaled) {
+            report.add(subsystem, asset, MemoryReport::Kind::Decoded, scaled.second.bitmap.size() * sizeof(TD::Color));
+            report.add(subsystem, asset, MemoryReport::Kind::Gpu, scaled.second.texture ? scaled.second.texture->bytes() : 0);
+        }
     }
 
 private:
+    struct Scaled {
+        std::vector<TD::Color> bitmap;
+        std::optional<GpuTexture> texture;
+    };
+
+    Scaled &scaledCopy(int factor, ImageScaler::Filter filter) const {
+        auto &scaled = m_scaled[{ factor, filter }];
+
+        if (scaled.bitmap.empty()) {
+            TD_PROFILE_SCOPE("image scale");
+            scaled.bitmap = ImageScaler::scale(m_bitmap, m_width, m_height, factor, filter);
+        }
+
+        return scaled;
+    }
+
     int m_width;
     int m_height;
     std::vector<TD::Color> m_bitmap;
-    Texture2D m_texture;
-    bool m_textureLoaded;
+    mutable std::optional<GpuTexture> m_texture;
+    mutable std::map<std::pair<int, ImageScaler::Filter>, Scaled> m_scaled;
 };
 
 };
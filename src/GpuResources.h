@@ -0,0 +1,242 @@
+//
+//  GpuResources.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <rlgl.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Profiler.h"
+
+// Live GPU objects owned by GpuMesh and GpuTexture. There is a single
+// GL context, so this is process wide.
+
+class GpuStats {
+public:
+    static GpuStats &shared() {
+        static GpuStats stats;
+        return stats;
+    }
+
+    int liveBuffers()      const { return m_buffers; }
+    long long bufferBytes() const { return m_bufferBytes; }
+
+    int liveTextures()      const { return m_textures; }
+    long long textureBytes() const { return m_textureBytes; }
+
+    void buffersCreated(int count, long long bytes)  { m_buffers += count; m_bufferBytes += bytes; }
+    void buffersReleased(int count, long long bytes) { m_buffers -= count; m_bufferBytes -= bytes; }
+
+    void textureCreated(long long bytes)  { m_textures++; m_textureBytes += bytes; }
+    void textureReleased(long long bytes) { m_textures--; m_textureBytes -= bytes; }
+
+    void print(const char *label) const {
+        printf("[gpu] %-16s %4d buffers %8lld bytes, %3d textures %8lld bytes\n",
+               label,
+               liveBuffers(), bufferBytes(),
+               liveTextures(), textureBytes());
+    }
+
+private:
+    std::atomic<int> m_buffers { 0 };
+    std::atomic<long long> m_bufferBytes { 0 };
+    std::atomic<int> m_textures { 0 };
+    std::atomic<long long> m_textureBytes { 0 };
+};
+
+// Uploaded copy of a CPU mesh (see CpuMesh::view). Frees its vertex array
+// and buffers when destroyed; the arrays it was made from must outlive it.
+
+class GpuMesh {
+public:
+    GpuMesh(const Mesh &view, long long bytes)
+        : m_state(std::make_unique<State>())
+    {
+        auto &mesh = m_state->mesh;
+        mesh = view;
+
+        UploadMesh(&mesh, false);
+
+        // UploadMesh allocates the id array itself, keep our own copy
+        if (mesh.vboId) {
+            for (int i = 0; i < MaxBuffers; i++)
+                m_state->vboId[i] = mesh.vboId[i];
+
+            MemFree(mesh.vboId);
+        }
+
+        mesh.vboId = m_state->vboId;
+
+        m_state->bytes = bytes;
+        GpuStats::shared().buffersCreated(bufferCount(), m_state->bytes);
+
+        m_state->material = DefaultMaterial();
+
+        auto &model = m_state->model;
+        model = { 0 };
+        model.transform = MatrixIdentity();
+        model.meshCount = 1;
+        model.materialCount = 1;
+        model.meshes = &m_state->mesh;
+        model.materials = &m_state->material;
+        model.meshMaterial = &m_state->meshMaterial;
+    }
+
+    GpuMesh(const GpuMesh &) = delete;
+    GpuMesh &operator=(const GpuMesh &) = delete;
+
+    GpuMesh(GpuMesh &&) = default;
+
+    GpuMesh &operator=(GpuMesh &&other) {
+        release();
+        m_state = std::move(other.m_state);
+        return *this;
+    }
+
+    ~GpuMesh() {
+        release();
+    }
+
+    const Mesh &mesh() const {
+        return m_state->mesh;
+    }
+
+    void draw(const Matrix &transform) const {
+        Profiler::shared().countDraw(m_state->mesh.triangleCount);
+        DrawMesh(m_state->mesh, m_state->material, transform);
+    }
+
+    // Same, with texture bound in place of the default white one
+    void draw(const Matrix &transform, Texture2D texture) const {
+        MaterialMap maps[MaterialMapCount];
+        memcpy(maps, m_state->material.maps, sizeof(maps));
+        maps[MATERIAL_MAP_DIFFUSE].texture = texture;
+
+        auto material = m_state->material;
+        material.maps = maps;
+
+        Profiler::shared().countDraw(m_state->mesh.triangleCount);
+        DrawMesh(m_state->mesh, material, transform);
+    }
+
+    // Not to be passed to UnloadModel, it does not own raylib allocations
+    Model &model() {
+        return m_state->model;
+    }
+
+    long long bytes() const {
+        return m_state->bytes;
+    }
+
+private:
+    static const int MaxBuffers = 7;
+
+    // MAX_MATERIAL_MAPS, from raylib's config.h; DrawMesh walks all of them
+    static const int MaterialMapCount = 12;
+
+    struct State {
+        Mesh mesh;
+        Material material;
+        Model model;
+        int meshMaterial = 0;
+        unsigned int vboId[MaxBuffers] = { 0 };
+        long long bytes = 0;
+    };
+
+    static Material DefaultMaterial() {
+        static Material material = LoadMaterialDefault();
+        return material;
+    }
+
+    int bufferCount() const {
+        int count = 0;
+
+        for (auto id : m_state->vboId)
+            count += id ? 1 : 0;
+
+        return count;
+    }
+
+    void release() {
+        if (!m_state)
+            return;
+
+        GpuStats::shared().buffersReleased(bufferCount(), m_state->bytes);
+
+        if (m_state->mesh.vaoId)
+            rlUnloadVertexArray(m_state->mesh.vaoId);
+
+        for (auto id : m_state->vboId) {
+            if (id)
+                rlUnloadVertexBuffer(id);
+        }
+
+        m_state.reset();
+    }
+
+    std::unique_ptr<State> m_state;
+};
+
+class GpuTexture {
+public:
+    explicit GpuTexture(const Image &image)
+        : m_texture(LoadTextureFromImage(image))
+        , m_bytes(GetPixelDataSize(image.width, image.height, image.format))
+    {
+        GpuStats::shared().textureCreated(m_bytes);
+    }
+
+    GpuTexture(const GpuTexture &) = delete;
+    GpuTexture &operator=(const GpuTexture &) = delete;
+
+    GpuTexture(GpuTexture &&other)
+        : m_texture(other.m_texture)
+        , m_bytes(other.m_bytes)
+    {
+        other.m_texture = { 0 };
+    }
+
+    GpuTexture &operator=(GpuTexture &&other) {
+        release();
+        std::swap(m_texture, other.m_texture);
+        std::swap(m_bytes, other.m_bytes);
+        return *this;
+    }
+
+    ~GpuTexture() {
+        release();
+    }
+
+    const Texture2D &texture() const {
+        return m_texture;
+    }
+
+    long long bytes() const {
+        return m_bytes;
+    }
+
+private:
+    void release() {
+        if (m_texture.id == 0)
+            return;
+
+        UnloadTexture(m_texture);
+        GpuStats::shared().textureReleased(m_bytes);
+        m_texture = { 0 };
+    }
+
+    Texture2D m_texture;
+    long long m_bytes;
+};
@@ -0,0 +1,128 @@
+//
+//  HotReload.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <cstdio>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Resources.h"
+#include "FileWatcher.h"
+
+// Entries of the archives whose bytes are not what they were, including
+// ones that appeared or went away
+struct DataChanges {
+    std::vector<TD::PackedEntry> entries;
+
+    // A file of the shared archives by name, like "OTWCOL.BIN"
+    bool file(const std::string &name) const {
+        auto h1 = TD::Hash1(name);
+        auto h2 = TD::Hash2(name);
+
+        for (auto &entry : entries) {
+            if (entry.hash1 == h1 && entry.hash2 == h2 && isShared(entry.archive))
+                return true;
+        }
+
+        return false;
+    }
+
+    // Anything in one archive, like "scene01.dat" or "ccerv.pob"
+    bool archive(const std::string &name) const {
+        for (auto &entry : entries) {
+            if (entry.archive == name)
+                return true;
+        }
+
+        return false;
+    }
+
+    void print() const {
+        for (auto &entry : entries)
+            printf("[reload] %-12s %04x:%04x\n", entry.archive.c_str(), entry.hash1, entry.hash2);
+    }
+
+private:
+    static bool isShared(const std::string &archive) {
+        for (auto &shared : TD::PackedArchives()) {
+            if (shared.second == archive)
+                return true;
+        }
+
+        return false;
+    }
+};
+
+// Watches the data directory and, when something in it is written, hashes
+// every archive entry again to tell which ones changed. The stock data is
+// under a megabyte, so that takes a few milliseconds and only happens on
+// a write.
+//
+// Cars and tracks are those Resources was made with; playdisk.dat is not
+// read again.
+
+class DataWatcher {
+public:
+    explicit DataWatcher(const TD::Resources &res)
+        : m_res(res)
+        , m_watcher(res.dataPath())
+        , m_index(index())
+    { }
+
+    // Main thread, between frames. Writes are left queued until then, so
+    // not calling this while a reload is running holds the next one back.
+    std::optional<DataChanges> poll() {
+        if (m_watcher.poll().empty())
+            return {};
+
+        auto current = index();
+        DataChanges changes;
+
+        for (auto &entry : current) {
+            auto previous = m_index.find(entry.first);
+
+            if (previous == m_index.end() || previous->second != entry.second)
+                changes.entries.push_back(entryFor(entry.first, entry.second));
+        }
+
+        for (auto &entry : m_index) {
+            if (current.find(entry.first) == current.end())
+                changes.entries.push_back(entryFor(entry.first, 0));
+        }
+
+        m_index = std::move(current);
+
+        if (changes.entries.empty())
+            return {};
+
+        return changes;
+    }
+
+private:
+    using Key = std::tuple<std::string, uint16_t, uint16_t>;
+
+    static TD::PackedEntry entryFor(const Key &key, uint64_t contentHash) {
+        return { std::get<0>(key), std::get<1>(key), std::get<2>(key), contentHash };
+    }
+
+    std::map<Key, uint64_t> index() const {
+        std::map<Key, uint64_t> index;
+
+        for (auto &entry : m_res.packedEntries())
+            index[{ entry.archive, entry.hash1, entry.hash2 }] = entry.contentHash;
+
+        return index;
+    }
+
+    const TD::Resources &m_res;
+    FileWatcher m_watcher;
+    std::map<Key, uint64_t> m_index;
+};
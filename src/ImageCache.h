@@ -0,0 +1,186 @@
+//
+//  ImageCache.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "GameImage.h"
+#include "RawBuffer.h"
+
+namespace TD {
+
+// A file of the game's archives: the archive and the hashes of its name,
+// as in PackedEntry
+struct AssetId {
+    std::string archive;
+    uint16_t hash1;
+    uint16_t hash2;
+
+    bool operator<(const AssetId &other) const {
+        return std::tie(archive, hash1, hash2) < std::tie(other.archive, other.hash1, other.hash2);
+    }
+
+    bool operator==(const AssetId &other) const {
+        return archive == other.archive && hash1 == other.hash1 && hash2 == other.hash2;
+    }
+};
+
+// Decoded images and palettes, handed to everyone asking for the same one:
+// a second screen showing SELECT.LZ shares the first one's decode and
+// texture. Images are told apart by file, width, palette and colour base;
+// palettes by their id and version, so palettes have to come from here too
+// for two users to share images.
+//
+// Thread safe. The first to ask decodes, outside the lock; anyone asking
+// for the same thing meanwhile waits for that decode instead of making
+// another. Only weak references are kept, what nobody uses any more goes.
+
+class ImageCache {
+public:
+    struct Stats {
+        int hits;
+        int misses;
+        int waits;      // for a decode another thread was running
+    };
+
+    std::shared_ptr<const GamePalette> palette(const AssetId &asset, const RawBuffer &file, int at) {
+        return lookup(m_palettes, { asset, at }, [&] {
+            return std::make_shared<const GamePalette>(*file.get(), at);
+        });
+    }
+
+    std::shared_ptr<const GameImage> image(const AssetId &asset, const RawBuffer &file, int width,
+                                           const GamePalette &palette, int colorBase = 0)
+    {
+        ImageKey key = { asset, width, palette.id(), palette.version(), colorBase };
+
+        return lookup(m_images, key, [&] {
+            return std::make_shared<const GameImage>(*file.get(), width, palette, colorBase);
+        });
+    }
+
+    // The file was edited: what was made from it is not handed out again.
+    // Who holds it keeps it, and decodes running for it are not stored.
+    void invalidate(const AssetId &asset) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        forget(m_palettes, [&](const PaletteKey &key) { return key.first == asset; });
+        forget(m_images,   [&](const ImageKey &key)   { return std::get<0>(key) == asset; });
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    void print() const {
+        auto stats = this->stats();
+        printf("[images] %d hits, %d misses, %d waited for a decode\n", stats.hits, stats.misses, stats.waits);
+    }
+
+private:
+    using PaletteKey = std::pair<AssetId, int>;
+    using ImageKey = std::tuple<AssetId, int, int, int, int>;   // width, palette id and version, colour base
+
+    template <typename Value>
+    struct Slot {
+        std::weak_ptr<const Value> value;
+        std::shared_future<std::shared_ptr<const Value>> pending;
+        int decode = 0;
+    };
+
+    template <typename Key, typename Value, typename Make>
+    std::shared_ptr<const Value> lookup(std::map<Key, Slot<Value>> &slots, const Key &key, Make make) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        auto &slot = slots[key];
+
+        if (auto value = slot.value.lock()) {
+            m_stats.hits++;
+            return value;
+        }
+
+        if (slot.pending.valid()) {
+            m_stats.waits++;
+
+            auto pending = slot.pending;
+            lock.unlock();
+
+            return pending.get();
+        }
+
+        m_stats.misses++;
+
+        std::promise<std::shared_ptr<const Value>> promise;
+        slot.pending = promise.get_future().share();
+        slot.decode = ++m_decodes;
+
+        auto decode = slot.decode;
+        lock.unlock();
+
+        std::shared_ptr<const Value> value;
+
+        try {
+            value = make();
+        } catch (...) {
+            // who waits gets the same error, the next to ask tries again
+            promise.set_exception(std::current_exception());
+
+            lock.lock();
+
+            if (auto found = slots.find(key); found != slots.end() && found->second.decode == decode)
+                found->second.pending = {};
+
+            throw;
+        }
+
+        promise.set_value(value);
+
+        lock.lock();
+
+        // unless it was invalidated meanwhile
+        auto found = slots.find(key);
+
+        if (found != slots.end() && found->second.decode == decode) {
+            found->second.value = value;
+            found->second.pending = {};
+        }
+
+        return value;
+    }
+
+    // Also drops what expired, so the maps do not grow with every reload
+    template <typename Key, typename Value, typename Match>
+    static void forget(std::map<Key, Slot<Value>> &slots, Match match) {
+        for (auto i = slots.begin(); i != slots.end();) {
+            auto expired = !i->second.pending.valid() && i->second.value.expired();
+
+            if (expired || match(i->first))
+                i = slots.erase(i);
+            else
+                i++;
+        }
+    }
+
+    mutable std::mutex m_mutex;
+    std::map<PaletteKey, Slot<GamePalette>> m_palettes;
+    std::map<ImageKey, Slot<GameImage>> m_images;
+    Stats m_stats = { 0 };
+    int m_decodes = 0;
+};
+
+}
@@ -0,0 +1,461 @@
+//
+//  ImageScaler.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TD_SCALER_SSE2 1
+#else
+#define TD_SCALER_SSE2 0
+#endif
+
+namespace TD {
+
+// Integer upscaling of the 320x200 artwork on the CPU, so it reaches the
+// screen crisp instead of through bilinear filtering.
+//
+//   Nearest  every pixel becomes a factor x factor block
+//   Epx      Scale2x / Scale3x (AdvMAME), 4x is Scale2x twice; other
+//            factors fall back to Nearest
+//   Xbr      Hyllian's xBR level 2 at 2x, 4x is it twice; 3x falls back
+//            to Epx, other factors to Nearest
+//
+// Nearest and Epx compare pixels exactly, as indexed artwork has no near
+// colours, and work on four pixels at a time, in SSE2 registers when
+// available and in plain arrays otherwise, with the same results. Xbr
+// weighs colour distances and blends edges, one pixel at a time.
+
+class ImageScaler {
+public:
+    enum class Filter {
+        Nearest,
+        Epx,
+        Xbr,
+    };
+
+    // src is width x height pixels of 4 bytes, rows top first
+    template <typename Pixel>
+    static std::vector<Pixel> scale(const std::vector<Pixel> &src, int width, int height, int factor, Filter filter) {
+        static_assert(sizeof(Pixel) == sizeof(uint32_t), "pixels are 32 bit");
+
+        std::vector<uint32_t> in(src.size());
+        memcpy(in.data(), src.data(), src.size() * sizeof(uint32_t));
+
+        auto out = scale(in, width, height, factor, filter);
+
+        std::vector<Pixel> result(out.size());
+        memcpy(result.data(), out.data(), out.size() * sizeof(uint32_t));
+        return result;
+    }
+
+    static std::vector<uint32_t> scale(const std::vector<uint32_t> &src, int width, int height, int factor, Filter filter) {
+        if (filter == Filter::Xbr) {
+            switch (factor) {
+                case 2: return xbr2x(src, width, height);
+                case 3: return scale3x(src, width, height);
+                case 4: return xbr2x(xbr2x(src, width, height), width * 2, height * 2);
+            }
+        }
+
+        if (filter == Filter::Epx) {
+            switch (factor) {
+                case 2: return scale2x(src, width, height);
+                case 3: return scale3x(src, width, height);
+                case 4: return scale2x(scale2x(src, width, height), width * 2, height * 2);
+            }
+        }
+
+        return nearest(src, width, height, factor);
+    }
+
+private:
+#if TD_SCALER_SSE2
+    using Lanes = __m128i;
+
+    static Lanes load(const uint32_t *p)         { return _mm_loadu_si128((const __m128i *)p); }
+    static void store(uint32_t *p, Lanes v)      { _mm_storeu_si128((__m128i *)p, v); }
+    static Lanes equal(Lanes a, Lanes b)         { return _mm_cmpeq_epi32(a, b); }
+    static Lanes both(Lanes a, Lanes b)          { return _mm_and_si128(a, b); }
+    static Lanes either(Lanes a, Lanes b)        { return _mm_or_si128(a, b); }
+    static Lanes butNot(Lanes a, Lanes b)        { return _mm_andnot_si128(b, a); }
+    static Lanes select(Lanes m, Lanes a, Lanes b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+
+    static void interleave(Lanes a, Lanes b, uint32_t *out) {
+        store(out,     _mm_unpacklo_epi32(a, b));
+        store(out + 4, _mm_unpackhi_epi32(a, b));
+    }
+#else
+    struct Lanes {
+        uint32_t v[4];
+    };
+
+    template <typename Op>
+    static Lanes each(Lanes a, Lanes b, Op op) {
+        Lanes r;
+        for (int i = 0; i < 4; i++)
+            r.v[i] = op(a.v[i], b.v[i]);
+        return r;
+    }
+
+    static Lanes load(const uint32_t *p)         { Lanes r; memcpy(r.v, p, sizeof(r.v)); return r; }
+    static void store(uint32_t *p, Lanes v)      { memcpy(p, v.v, sizeof(v.v)); }
+    static Lanes equal(Lanes a, Lanes b)         { return each(a, b, [](uint32_t x, uint32_t y) { return x == y ? ~0u : 0u; }); }
+    static Lanes both(Lanes a, Lanes b)          { return each(a, b, [](uint32_t x, uint32_t y) { return x & y; }); }
+    static Lanes either(Lanes a, Lanes b)        { return each(a, b, [](uint32_t x, uint32_t y) { return x | y; }); }
+    static Lanes butNot(Lanes a, Lanes b)        { return each(a, b, [](uint32_t x, uint32_t y) { return x & ~y; }); }
+    static Lanes select(Lanes m, Lanes a, Lanes b) { return either(both(m, a), butNot(b, m)); }
+
+    static void interleave(Lanes a, Lanes b, uint32_t *out) {
+        for (int i = 0; i < 4; i++) {
+            out[i * 2]     = a.v[i];
+            out[i * 2 + 1] = b.v[i];
+        }
+    }
+#endif
+
+    static void interleave3(Lanes a, Lanes b, Lanes c, uint32_t *out) {
+        uint32_t va[4], vb[4], vc[4];
+        store(va, a);
+        store(vb, b);
+        store(vc, c);
+
+        for (int i = 0; i < 4; i++) {
+            out[i * 3]     = va[i];
+            out[i * 3 + 1] = vb[i];
+            out[i * 3 + 2] = vc[i];
+        }
+    }
+
+    // a != b as a mask
+    static Lanes differ(Lanes a, Lanes b) {
+        return butNot(equal(a, a), equal(a, b));
+    }
+
+    // Copy with the edge pixels repeated once around, and rows padded so
+    // four pixels can always be read past any x
+    struct Padded {
+        Padded(const std::vector<uint32_t> &src, int width, int height)
+            : stride(width + 2 + 4)
+            , pixels(stride * (height + 2))
+        {
+            for (int y = -1; y <= height; y++) {
+                auto from = &src[std::min(std::max(y, 0), height - 1) * width];
+                auto to = &pixels[(y + 1) * stride];
+
+                to[0] = from[0];
+                memcpy(to + 1, from, width * sizeof(uint32_t));
+
+                for (int x = width + 1; x < stride; x++)
+                    to[x] = from[width - 1];
+            }
+        }
+
+        // pixel (x, y) of the source, -1 <= x, y <= size
+        const uint32_t *at(int x, int y) const {
+            return &pixels[(y + 1) * stride + x + 1];
+        }
+
+        int stride;
+        std::vector<uint32_t> pixels;
+    };
+
+    static std::vector<uint32_t> nearest(const std::vector<uint32_t> &src, int width, int height, int factor) {
+        if (factor <= 1)
+            return src;
+
+        auto outWidth = width * factor;
+        std::vector<uint32_t> out(outWidth * height * factor);
+
+        for (int y = 0; y < height; y++) {
+            auto row = &out[y * factor * outWidth];
+            auto from = &src[y * width];
+
+            int x = 0;
+
+            if (factor == 2) {
+                for (; x + 4 <= width; x += 4) {
+                    auto p = load(from + x);
+                    interleave(p, p, row + x * 2);
+                }
+            }
+
+            for (; x < width; x++) {
+                for (int i = 0; i < factor; i++)
+                    row[x * factor + i] = from[x];
+            }
+
+            for (int i = 1; i < factor; i++)
+                memcpy(row + i * outWidth, row, outWidth * sizeof(uint32_t));
+        }
+
+        return out;
+    }
+
+    //   A        E0 E1
+    // C P B  ->  E2 E3
+    //   D
+    static std::vector<uint32_t> scale2x(const std::vector<uint32_t> &src, int width, int height) {
+        auto padded = Padded(src, width, height);
+        auto groups = (width + 3) / 4;
+        auto outWidth = width * 2;
+
+        std::vector<uint32_t> out(outWidth * height * 2);
+        std::vector<uint32_t> top(groups * 8), bottom(groups * 8);
+
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < groups * 4; x += 4) {
+                auto a = load(padded.at(x, y - 1));
+                auto c = load(padded.at(x - 1, y));
+                auto p = load(padded.at(x, y));
+                auto b = load(padded.at(x + 1, y));
+                auto d = load(padded.at(x, y + 1));
+
+                auto ab = equal(a, b), ac = equal(a, c);
+                auto db = equal(d, b), dc = equal(d, c);
+
+                auto e0 = select(butNot(butNot(ac, dc), ab), a, p);
+                auto e1 = select(butNot(butNot(ab, ac), db), b, p);
+                auto e2 = select(butNot(butNot(dc, db), ac), c, p);
+                auto e3 = select(butNot(butNot(db, ab), dc), d, p);
+
+                interleave(e0, e1, &top[x * 2]);
+                interleave(e2, e3, &bottom[x * 2]);
+            }
+
+            memcpy(&out[(y * 2)     * outWidth], top.data(),    outWidth * sizeof(uint32_t));
+            memcpy(&out[(y * 2 + 1) * outWidth], bottom.data(), outWidth * sizeof(uint32_t));
+        }
+
+        return out;
+    }
+
+    // A B C      E0 E1 E2
+    // D E F  ->  E3 E4 E5
+    // G H I      E6 E7 E8
+    static std::vector<uint32_t> scale3x(const std::vector<uint32_t> &src, int width, int height) {
+        auto padded = Padded(src, width, height);
+        auto groups = (width + 3) / 4;
+        auto outWidth = width * 3;
+
+        std::vector<uint32_t> out(outWidth * height * 3);
+        std::vector<uint32_t> rows[3] = {
+            std::vector<uint32_t>(groups * 12),
+            std::vector<uint32_t>(groups * 12),
+            std::vector<uint32_t>(groups * 12),
+        };
+
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < groups * 4; x += 4) {
+                auto A = load(padded.at(x - 1, y - 1));
+                auto B = load(padded.at(x,     y - 1));
+                auto C = load(padded.at(x + 1, y - 1));
+                auto D = load(padded.at(x - 1, y));
+                auto E = load(padded.at(x,     y));
+                auto F = load(padded.at(x + 1, y));
+                auto G = load(padded.at(x - 1, y + 1));
+                auto H = load(padded.at(x,     y + 1));
+                auto I = load(padded.at(x + 1, y + 1));
+
+                // the four corner conditions of AdvMAME3x
+                auto db = butNot(butNot(equal(D, B), equal(D, H)), equal(B, F));
+                auto bf = butNot(butNot(equal(B, F), equal(B, D)), equal(F, H));
+                auto dh = butNot(butNot(equal(D, H), equal(D, B)), equal(H, F));
+                auto hf = butNot(butNot(equal(H, F), equal(H, D)), equal(F, B));
+
+                auto e0 = select(db, D, E);
+                auto e1 = select(either(both(db, differ(E, C)), both(bf, differ(E, A))), B, E);
+                auto e2 = select(bf, F, E);
+                auto e3 = select(either(both(db, differ(E, G)), both(dh, differ(E, A))), D, E);
+                auto e5 = select(either(both(bf, differ(E, I)), both(hf, differ(E, C))), F, E);
+                auto e6 = select(dh, D, E);
+                auto e7 = select(either(both(dh, differ(E, I)), both(hf, differ(E, G))), H, E);
+                auto e8 = select(hf, F, E);
+
+                interleave3(e0, e1, e2, &rows[0][x * 3]);
+                interleave3(e3, E,  e5, &rows[1][x * 3]);
+                interleave3(e6, e7, e8, &rows[2][x * 3]);
+            }
+
+            for (int i = 0; i < 3; i++)
+                memcpy(&out[(y * 3 + i) * outWidth], rows[i].data(), outWidth * sizeof(uint32_t));
+        }
+
+        return out;
+    }
+
+    // xBR looks at the 5x5 block around E, named after the reference's:
+    //
+    //        A1  B1  C1
+    //    A0  A   B   C   C4
+    //    D0  D   E   F   F4
+    //    G0  G   H   I   I4
+    //        G5  H5  I5
+    //
+    // Colour distances are between YUV values, weighted towards luma.
+    struct XbrSource {
+        XbrSource(const std::vector<uint32_t> &src, int width, int height)
+            : src(src)
+            , yuv(src.size())
+            , width(width)
+            , height(height)
+        {
+            for (size_t i = 0; i < src.size(); i++) {
+                auto r = (int)(src[i] & 0xff);
+                auto g = (int)((src[i] >> 8) & 0xff);
+                auto b = (int)((src[i] >> 16) & 0xff);
+
+                auto y = ( 299 * r + 587 * g + 114 * b) / 1000;
+                auto u = (-169 * r - 331 * g + 500 * b) / 1000 + 128;
+                auto v = ( 500 * r - 419 * g -  81 * b) / 1000 + 128;
+
+                yuv[i] = { y, u, v };
+            }
+        }
+
+        // index of (x, y), the edges repeated outwards
+        int at(int x, int y) const {
+            x = std::min(std::max(x, 0), width - 1);
+            y = std::min(std::max(y, 0), height - 1);
+            return y * width + x;
+        }
+
+        uint32_t pixel(int i) const {
+            return src[i];
+        }
+
+        int distance(int a, int b) const {
+            return 48 * abs(yuv[a].y - yuv[b].y) + 7 * abs(yuv[a].u - yuv[b].u) + 6 * abs(yuv[a].v - yuv[b].v);
+        }
+
+        bool same(int a, int b) const {
+            return distance(a, b) < 48 * 15;
+        }
+
+        struct Yuv {
+            int y, u, v;
+        };
+
+        const std::vector<uint32_t> &src;
+        std::vector<Yuv> yuv;
+        int width;
+        int height;
+    };
+
+    // dst moves by alpha / 256 towards src, every channel
+    static uint32_t blend(uint32_t dst, uint32_t src, int alpha) {
+        uint32_t out = 0;
+
+        for (int shift = 0; shift < 32; shift += 8) {
+            auto d = (int)((dst >> shift) & 0xff);
+            auto s = (int)((src >> shift) & 0xff);
+            out |= (uint32_t)(d + (((s - d) * alpha) >> 8)) << shift;
+        }
+
+        return out;
+    }
+
+    // One corner of the 2x2 block of E, the one towards I; the others are
+    // the same with the neighbourhood rotated. n1 and n2 are the outputs
+    // next to it along the two sides, n3 is the corner itself.
+    static void xbrCorner(const XbrSource &k, uint32_t *out,
+                          int E, int I, int H, int F, int G, int C, int D, int B,
+                          int F4, int I4, int H5, int I5,
+                          int n1, int n2, int n3)
+    {
+        auto p = [&](int i) { return k.pixel(i); };
+        auto df = [&](int a, int b) { return k.distance(a, b); };
+        auto eq = [&](int a, int b) { return k.same(a, b); };
+
+        if (p(E) == p(H) || p(E) == p(F))
+            return;
+
+        auto e = df(E, C) + df(E, G) + df(I, H5) + df(I, F4) + (df(H, F) << 2);
+        auto i = df(H, D) + df(H, I5) + df(F, I4) + df(F, B) + (df(E, I) << 2);
+
+        if (e > i)
+            return;
+
+        auto px = df(E, F) <= df(E, H) ? p(F) : p(H);
+
+        auto edge = e < i && ((!eq(F, B) && !eq(H, D))
+                              || (eq(E, I) && !eq(F, I4) && !eq(H, I5))
+                              || eq(E, G) || eq(E, C));
+
+        if (!edge) {
+            out[n3] = blend(out[n3], px, 128);
+            return;
+        }
+
+        auto ke = df(F, G);
+        auto ki = df(H, C);
+
+        auto left = (ke << 1) <= ki && p(E) != p(G) && p(D) != p(G);
+        auto up   = ke >= (ki << 1) && p(E) != p(C) && p(B) != p(C);
+
+        if (left && up) {
+            out[n3] = blend(out[n3], px, 224);
+            out[n2] = blend(out[n2], px, 64);
+            out[n1] = out[n2];
+        }
+        else if (left) {
+            out[n3] = blend(out[n3], px, 192);
+            out[n2] = blend(out[n2], px, 64);
+        }
+        else if (up) {
+            out[n3] = blend(out[n3], px, 192);
+            out[n1] = blend(out[n1], px, 64);
+        }
+        else {
+            out[n3] = blend(out[n3], px, 128);
+        }
+    }
+
+    static std::vector<uint32_t> xbr2x(const std::vector<uint32_t> &src, int width, int height) {
+        auto k = XbrSource(src, width, height);
+        auto outWidth = width * 2;
+
+        std::vector<uint32_t> out(outWidth * height * 2);
+
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                auto n = [&](int dx, int dy) { return k.at(x + dx, y + dy); };
+
+                auto A1 = n(-1, -2), B1 = n(0, -2), C1 = n(1, -2);
+                auto A0 = n(-2, -1), A = n(-1, -1), B = n(0, -1), C = n(1, -1), C4 = n(2, -1);
+                auto D0 = n(-2,  0), D = n(-1,  0), E = n(0,  0), F = n(1,  0), F4 = n(2,  0);
+                auto G0 = n(-2,  1), G = n(-1,  1), H = n(0,  1), I = n(1,  1), I4 = n(2,  1);
+                auto G5 = n(-1,  2), H5 = n(0,  2), I5 = n(1,  2);
+
+                // top left, top right, bottom left, bottom right
+                uint32_t block[4];
+                block[0] = block[1] = block[2] = block[3] = k.pixel(E);
+
+                xbrCorner(k, block, E, I, H, F, G, C, D, B, F4, I4, H5, I5, 1, 2, 3);
+                xbrCorner(k, block, E, C, F, B, I, A, H, D, B1, C1, F4, C4, 0, 3, 1);
+                xbrCorner(k, block, E, A, B, D, C, G, F, H, D0, A0, B1, A1, 2, 1, 0);
+                xbrCorner(k, block, E, G, D, H, A, I, B, F, H5, G5, D0, G0, 3, 0, 2);
+
+                auto row = &out[(y * 2) * outWidth + x * 2];
+                row[0] = block[0];
+                row[1] = block[1];
+                row[outWidth]     = block[2];
+                row[outWidth + 1] = block[3];
+            }
+        }
+
+        return out;
+    }
+};
+
+}
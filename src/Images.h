@@ -12,58 +12,83 @@
 
 namespace TD {
 
+// Both share their images with anyone else asking Resources for them
+
+using SharedImage = std::shared_ptr<const GameImage>;
+
 struct MenuImages {
     MenuImages(Resources &res)
-        : palette(res.file("SELCOLR.BIN"), 0x10)
-        , select (res.file("SELECT.LZ"),  320, palette)
-        , compass(res.file("COMPASS.LZ"), 152, palette)
-        , detail1(res.file("DETAIL1.LZ"), 184, palette)
-        , detail2(res.file("DETAIL2.LZ"), 184, palette)
+        : palette(res.palette("SELCOLR.BIN", 0x10))
+        , select (res.image("SELECT.LZ",  320, *palette))
+        , compass(res.image("COMPASS.LZ", 152, *palette))
+        , detail1(res.image("DETAIL1.LZ", 184, *palette))
+        , detail2(res.image("DETAIL2.LZ", 184, *palette))
     { }
 
-    const GamePalette palette;
+    void accountMemory(MemoryReport &report, const std::string &subsystem) const {
+        select->accountMemory(report, subsystem, "select");
+        compass->accountMemory(report, subsystem, "compass");
+        detail1->accountMemory(report, subsystem, "detail1");
+        detail2->accountMemory(report, subsystem, "detail2");
+    }
+
+    const std::shared_ptr<const GamePalette> palette;
     
-    GameImage select;
-    GameImage compass;
-    GameImage detail1;
-    GameImage detail2;
+    SharedImage select;
+    SharedImage compass;
+    SharedImage detail1;
+    SharedImage detail2;
 };
 
 struct CarImages {
-    CarImages(const Car &car)
-        : carsicPalette(car.sicbin, 0x40)
-        , carPalette(car.col, 0x10)
-        , scPalette(car.sc, 0x10)
-        , top (car.top,  320, carPalette)
-        , bot1(car.bot1, 320, carPalette)
-        , bot2(car.bot2, 320, carPalette)
-        , lbot(car.lbot, 168, carPalette)
-        , rbot(car.rbot, 168, carPalette)
-        , etc (car.etc,   56, carPalette)
-        , sic (car.sic, 0x48, carsicPalette)
-        , fl1 (car.fl1,  208, scPalette)
-        , fl2 (car.fl2,  208, scPalette)
-        , bic (car.bic,  112, scPalette)
-        , sid (car.sid,  112, scPalette)
-        , icn (car.icn,  208, scPalette)
-    { }
+    CarImages(Resources &res, const Car &car)
+        : carsicPalette(res.palette(car, "SIC.BIN", 0x40))
+        , carPalette(res.palette(car, "COL.BIN", 0x10))
+        , scPalette(res.palette(car, "SC.BIN", 0x10))
+        , top (res.image(car, ".TOP",  320, *carPalette))
+        , bot1(res.image(car, "1.BOT", 320, *carPalette))
+        , bot2(res.image(car, "2.BOT", 320, *carPalette))
+        , lbot(res.image(car, "L.BOT", 168, *carPalette))
+        , rbot(res.image(car, "R.BOT", 168, *carPalette))
+        , etc (res.image(car, ".ETC",   56, *carPalette))
+        , sic (res.image(car, ".SIC", 0x48, *carsicPalette))
+        , fl1 (res.image(car, "FL1.LZ", 208, *scPalette))
+        , fl2 (res.image(car, "FL2.LZ", 208, *scPalette))
+        , bic (res.image(car, ".BIC",  112, *scPalette))
+        , sid (res.image(car, ".SID",  112, *scPalette))
+        , icn (res.image(car, ".ICN",  208, *scPalette))
+    {
+        car.decoded();
+    }
+
+    void accountMemory(MemoryReport &report, const std::string &subsystem) const {
+        const std::pair<const char *, const GameImage *> images[] = {
+            { "top", top.get() }, { "bot1", bot1.get() }, { "bot2", bot2.get() },
+            { "lbot", lbot.get() }, { "rbot", rbot.get() }, { "etc", etc.get() },
+            { "sic", sic.get() }, { "fl1", fl1.get() }, { "fl2", fl2.get() },
+            { "bic", bic.get() }, { "sid", sid.get() }, { "icn", icn.get() },
+        };
+
+        for (auto &image : images)
+            image.second->accountMemory(report, subsystem, image.first);
+    }
 
-    const GamePalette carsicPalette;
-    const GamePalette carPalette;
-    const GamePalette scPalette;
+    const std::shared_ptr<const GamePalette> carsicPalette;
+    const std::shared_ptr<const GamePalette> carPalette;
+    const std::shared_ptr<const GamePalette> scPalette;
 
-    GameImage top;
-    GameImage bot1;
-    GameImage bot2;
-    GameImage lbot;
-    GameImage rbot;
-    GameImage etc;
-    GameImage sic;
-    GameImage fl1;
-    GameImage fl2;
-    GameImage bic;
-    GameImage sid;
-    GameImage icn;
+    SharedImage top;
+    SharedImage bot1;
+    SharedImage bot2;
+    SharedImage lbot;
+    SharedImage rbot;
+    SharedImage etc;
+    SharedImage sic;
+    SharedImage fl1;
+    SharedImage fl2;
+    SharedImage bic;
+    SharedImage sid;
+    SharedImage icn;
 };
 
 };
@@ -0,0 +1,135 @@
+//
+//  MemoryReport.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "GpuResources.h"
+
+// Bytes held by each subsystem and asset, gathered on demand: owners add
+// what they hold in accountMemory(report), nothing hooks the allocator.
+//
+//   Raw      archive files as read from disk
+//   Decoded  bitmaps, models and tables made from them
+//   Mesh     CPU side triangles
+//   Gpu      buffers and textures uploaded from the above
+//
+// Only element bytes are counted, not allocator or vector overhead.
+
+class MemoryReport {
+public:
+    enum class Kind {
+        Raw,
+        Decoded,
+        Mesh,
+        Gpu,
+    };
+
+    static constexpr int KindCount = 4;
+
+    static const char *KindName(Kind kind) {
+        switch (kind) {
+            case Kind::Raw:     return "raw";
+            case Kind::Decoded: return "decoded";
+            case Kind::Mesh:    return "mesh";
+            case Kind::Gpu:     return "gpu";
+        }
+
+        return "";
+    }
+
+    struct Entry {
+        std::string subsystem;
+        std::string asset;
+        Kind kind;
+        long long bytes;
+    };
+
+    void add(const std::string &subsystem, const std::string &asset, Kind kind, long long bytes) {
+        if (bytes > 0)
+            m_entries.push_back({ subsystem, asset, kind, bytes });
+    }
+
+    const std::vector<Entry> &entries() const {
+        return m_entries;
+    }
+
+    long long total(Kind kind) const {
+        long long bytes = 0;
+
+        for (auto &entry : m_entries) {
+            if (entry.kind == kind)
+                bytes += entry.bytes;
+        }
+
+        return bytes;
+    }
+
+    long long total() const {
+        long long bytes = 0;
+
+        for (auto &entry : m_entries)
+            bytes += entry.bytes;
+
+        return bytes;
+    }
+
+    // A line per subsystem, and per asset too if asked
+    void print(const char *label, bool assets = false) const {
+        std::map<std::string, std::map<std::string, std::array<long long, KindCount>>> tree;
+
+        for (auto &entry : m_entries)
+            tree[entry.subsystem][entry.asset][(int)entry.kind] += entry.bytes;
+
+        printf("[memory] %s\n", label);
+        printf("[memory]   %-28s %10s %10s %10s %10s\n", "",
+               KindName(Kind::Raw), KindName(Kind::Decoded), KindName(Kind::Mesh), KindName(Kind::Gpu));
+
+        for (auto &subsystem : tree) {
+            std::array<long long, KindCount> sums = { 0 };
+
+            for (auto &asset : subsystem.second) {
+                for (int k = 0; k < KindCount; k++)
+                    sums[k] += asset.second[k];
+            }
+
+            printRow(subsystem.first, sums, 2);
+
+            if (!assets)
+                continue;
+
+            for (auto &asset : subsystem.second)
+                printRow(asset.first, asset.second, 4);
+        }
+
+        std::array<long long, KindCount> totals;
+
+        for (int k = 0; k < KindCount; k++)
+            totals[k] = total((Kind)k);
+
+        printRow("total", totals, 2);
+
+        // what is not owned by anything reported, like labels and the atlas
+        // of the default font, shows up as the difference
+        printf("[memory]   %-28s %10s %10s %10s %10lld\n", "gpu (all live)", "", "", "",
+               GpuStats::shared().bufferBytes() + GpuStats::shared().textureBytes());
+    }
+
+private:
+    static void printRow(const std::string &name, const std::array<long long, KindCount> &bytes, int indent) {
+        printf("[memory] %*s%-*s %10lld %10lld %10lld %10lld\n",
+               indent, "", 30 - indent, name.c_str(),
+               bytes[0], bytes[1], bytes[2], bytes[3]);
+    }
+
+    std::vector<Entry> m_entries;
+};
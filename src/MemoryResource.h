@@ -0,0 +1,110 @@
+//
+//  MemoryResource.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Where containers get their memory from, chosen at runtime: the heap, or
+// an Arena. The same shape as std::pmr, which Apple's libc++ only ships
+// from macOS 14 on.
+
+class MemoryResource {
+public:
+    virtual ~MemoryResource() = default;
+
+    void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        return doAllocate(bytes, alignment);
+    }
+
+    void deallocate(void *p, size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        doDeallocate(p, bytes, alignment);
+    }
+
+    // new and delete, what containers not told otherwise use
+    static MemoryResource *heap();
+
+private:
+    virtual void *doAllocate(size_t bytes, size_t alignment) = 0;
+    virtual void doDeallocate(void *p, size_t bytes, size_t alignment) = 0;
+
+    class Heap;
+};
+
+class MemoryResource::Heap: public MemoryResource {
+    void *doAllocate(size_t bytes, size_t alignment) override {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return ::operator new(bytes, std::align_val_t(alignment));
+
+        return ::operator new(bytes);
+    }
+
+    void doDeallocate(void *p, size_t, size_t alignment) override {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            ::operator delete(p, std::align_val_t(alignment));
+        else
+            ::operator delete(p);
+    }
+};
+
+inline MemoryResource *MemoryResource::heap() {
+    static Heap heap;
+    return &heap;
+}
+
+// Stays with its resource: moving a container keeps its memory where it
+// is, assigning into one using another resource copies the elements over,
+// and a copy of a container goes on the heap.
+
+template <typename T>
+class ResourceAllocator {
+public:
+    using value_type = T;
+
+    ResourceAllocator(MemoryResource *resource = MemoryResource::heap())
+        : m_resource(resource)
+    { }
+
+    template <typename U>
+    ResourceAllocator(const ResourceAllocator<U> &other)
+        : m_resource(other.resource())
+    { }
+
+    T *allocate(size_t count) {
+        return static_cast<T *>(m_resource->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, size_t count) {
+        m_resource->deallocate(p, count * sizeof(T), alignof(T));
+    }
+
+    ResourceAllocator select_on_container_copy_construction() const {
+        return ResourceAllocator();
+    }
+
+    MemoryResource *resource() const {
+        return m_resource;
+    }
+
+    template <typename U>
+    bool operator==(const ResourceAllocator<U> &other) const {
+        return m_resource == other.resource();
+    }
+
+    template <typename U>
+    bool operator!=(const ResourceAllocator<U> &other) const {
+        return m_resource != other.resource();
+    }
+
+private:
+    MemoryResource *m_resource;
+};
+
+template <typename T>
+using ResourceVector = std::vector<T, ResourceAllocator<T>>;
@@ -0,0 +1,278 @@
+//
+//  MeshBuilder.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+
+#include <cmath>
+#include <vector>
+
+#include "MemoryResource.h"
+#include "Models.h"
+#include "Scene.h"
+#include "Culling.h"
+
+// Vertex, index and colour arrays of a mesh, in GL world units. The raylib
+// Mesh struct is only produced on demand so it never points into storage
+// that has been moved away. The arrays come from memory; moving a mesh
+// keeps them there, assigning one into a mesh built elsewhere copies.
+
+class CpuMesh {
+public:
+    explicit CpuMesh(MemoryResource *memory = MemoryResource::heap())
+        : vertices(memory)
+        , indices(memory)
+        , colors(memory)
+    { }
+
+    CpuMesh(const CpuMesh &) = delete;
+    CpuMesh &operator=(const CpuMesh &) = delete;
+
+    CpuMesh(CpuMesh &&) = default;
+    CpuMesh &operator=(CpuMesh &&) = default;
+
+    int vertexCount()   const { return (int)(vertices.size() / 3); }
+    int triangleCount() const { return (int)(indices.size() / 3); }
+    bool empty()        const { return indices.empty(); }
+
+    long long byteSize() const {
+        return vertices.size() * sizeof(float)
+             + colors.size()   * sizeof(uint8_t)
+             + indices.size()  * sizeof(unsigned short);
+    }
+
+    BoundingBox boundingBox() const {
+        auto bounds = EmptyBoundingBox();
+
+        for (int i = 0; i < vertices.size(); i += 3) {
+            ExpandBoundingBox(bounds, Vector3 { vertices[i], vertices[i + 1], vertices[i + 2] });
+        }
+
+        return bounds;
+    }
+
+    Mesh view() const {
+        Mesh mesh = { 0 };
+
+        mesh.vertexCount   = vertexCount();
+        mesh.triangleCount = triangleCount();
+        mesh.vertices      = const_cast<float *>(vertices.data());
+        mesh.colors        = const_cast<unsigned char *>(colors.data());
+        mesh.indices       = const_cast<unsigned short *>(indices.data());
+
+        return mesh;
+    }
+
+    void clear() {
+        vertices.clear();
+        indices.clear();
+        colors.clear();
+    }
+
+    ResourceVector<float> vertices;
+    ResourceVector<unsigned short> indices;
+    ResourceVector<uint8_t> colors;
+};
+
+// Turns a TD::Model into triangles. Pure CPU work: it never calls into
+// raylib, so it can run on any thread and without a window.
+
+class MeshBuilder {
+public:
+    MeshBuilder(const TD::ColorTable &colors,
+                MemoryResource *memory = MemoryResource::heap())
+        : m_colors(colors)
+        , m_mesh(memory)
+    { }
+
+    static CpuMesh build(const TD::Model &model,
+                         const TD::ColorTable &colors,
+                         MemoryResource *memory = MemoryResource::heap())
+    {
+        return MeshBuilder(colors, memory).build(model);
+    }
+
+    static CpuMesh build(const TD::Model &model,
+                         const TD::GamePalette &palette,
+                         const TD::Scene &scene,
+                         MemoryResource *memory = MemoryResource::heap())
+    {
+        return MeshBuilder(scene.colorTable(palette), memory).build(model);
+    }
+
+    CpuMesh build(const TD::Model &model) {
+        m_mesh.clear();
+
+        if (model.polys().size() == 0)
+            return std::move(m_mesh);
+
+        // two triangles of their own per poly covers all but discs and
+        // lines; growing in an arena leaves the old arrays behind
+        auto vertices = model.polys().size() * 6;
+        m_mesh.vertices.reserve(vertices * 3);
+        m_mesh.colors.reserve(vertices * 4);
+        m_mesh.indices.reserve(vertices);
+
+        for (auto &poly : model.polys()) {
+            auto color = m_colors.get(poly.color1(), poly.color0());
+
+            switch (poly.type()) {
+                case 0:
+                case 1:
+                    if (poly.idx0() >= model.points().size())
+                        continue;
+
+                    addDisc(model.points()[poly.idx0()], 3, 3, color);
+                    break;
+
+                case 2:
+                case 3:
+                    if ((poly.idx0() >= model.points().size()) ||
+                        (poly.idx1() >= model.points().size()))
+                    {
+                        continue;
+                    }
+
+                    addLine(color, model.points()[poly.idx0()], model.points()[poly.idx1()]);
+                    break;
+
+                case 4:
+                case 5:
+                    if ((poly.idx0() >= model.points().size()) ||
+                        (poly.idx1() >= model.points().size()) ||
+                        (poly.idx2() >= model.points().size()))
+                    {
+                        continue;
+                    }
+
+                    addTriangle(model, color, poly.idx0(), poly.idx1(), poly.idx2());
+                    break;
+
+                case 6:
+                case 7:
+                    if ((poly.idx0() >= model.points().size()) ||
+                        (poly.idx1() >= model.points().size()) ||
+                        (poly.idx2() >= model.points().size()) ||
+                        (poly.idx3() >= model.points().size()))
+                    {
+                        continue;
+                    }
+
+                    addTriangle(model, color, poly.idx1(), poly.idx0(), poly.idx2());
+                    addTriangle(model, color, poly.idx2(), poly.idx0(), poly.idx3());
+                    break;
+            }
+        }
+
+        return std::move(m_mesh);
+    }
+
+private:
+    unsigned short addVertex(const TD::Point &point, TD::Color color) {
+        int idx = static_cast<int>(m_mesh.vertices.size());
+
+        m_mesh.vertices.push_back(point.x  / 4096.);
+        m_mesh.vertices.push_back(point.z  / 4096.);
+        m_mesh.vertices.push_back(-point.y / 4096.);
+
+        m_mesh.colors.push_back(color.r);
+        m_mesh.colors.push_back(color.g);
+        m_mesh.colors.push_back(color.b);
+        m_mesh.colors.push_back(color.a);
+
+        return idx / 3;
+    }
+
+    unsigned short addVertex(
+        float x, float y, float z,
+        const TD::Color &color, const TD::Point &t = {}
+    ) {
+        int idx = static_cast<int>(m_mesh.vertices.size());
+
+        m_mesh.vertices.push_back((x  + t.x) / 4096.);
+        m_mesh.vertices.push_back((z  + t.z) / 4096.);
+        m_mesh.vertices.push_back((-y + t.y) / 4096.);
+
+        m_mesh.colors.push_back(color.r);
+        m_mesh.colors.push_back(color.g);
+        m_mesh.colors.push_back(color.b);
+        m_mesh.colors.push_back(color.a);
+
+        return idx / 3;
+    }
+
+    void addTriangle(const TD::Model& model, const TD::Color& color, int idx1, int idx2, int idx3) {
+        m_mesh.indices.push_back(addVertex(model.points()[idx1], color));
+        m_mesh.indices.push_back(addVertex(model.points()[idx2], color));
+        m_mesh.indices.push_back(addVertex(model.points()[idx3], color));
+    }
+
+    void addTriangle(int idx1, int idx2, int idx3) {
+        m_mesh.indices.push_back(idx1);
+        m_mesh.indices.push_back(idx2);
+        m_mesh.indices.push_back(idx3);
+    }
+
+    void addQuad(int idx1, int idx2, int idx3, int idx4) {
+        addTriangle(idx1, idx2, idx3);
+        addTriangle(idx3, idx4, idx1);
+    }
+
+    void addLine(const TD::Color &color, const TD::Point a, const TD::Point b) {
+        static const int width = 1;
+
+        auto lbA = addVertex(TD::Point(a.x - width, a.y - width, a.z), color);
+        auto rbA = addVertex(TD::Point(a.x + width, a.y - width, a.z), color);
+        auto rtA = addVertex(TD::Point(a.x + width, a.y + width, a.z), color);
+        auto ltA = addVertex(TD::Point(a.x - width, a.y + width, a.z), color);
+
+        auto lbB = addVertex(TD::Point(b.x - width, b.y - width, b.z), color);
+        auto rbB = addVertex(TD::Point(b.x + width, b.y - width, b.z), color);
+        auto rtB = addVertex(TD::Point(b.x + width, b.y + width, b.z), color);
+        auto ltB = addVertex(TD::Point(b.x - width, b.y + width, b.z), color);
+
+        addQuad(lbA, rbA, rtA, ltA);
+        addQuad(lbB, rbB, rtB, ltB);
+
+        addQuad(lbA, rbA, rbB, lbB);
+        addQuad(ltA, rtA, rtB, ltB);
+
+        addQuad(lbA, ltA, ltB, ltB);
+        addQuad(rbA, rtA, rtB, rbB);
+    }
+
+    void addDisc(TD::Point position, float height, float radius, TD::Color &c) {
+        static int sectorCount = 10;
+
+        auto &t = position;
+
+        auto bottomCenter = addVertex(0, 0, -height * .5f, c, t);
+        auto topCenter    = addVertex(0, 0, -height * .5f, c, t);
+
+        for (int i = 0; i < sectorCount + 1; i++) {
+            float step = 2 * M_PI / float(sectorCount);
+            float angle = i * step;
+
+            auto v1 = addVertex(radius * cosf(angle),        radius * sinf(angle),        -height * .5f, c, t);
+            auto v2 = addVertex(radius * cosf(angle + step), radius * sinf(angle + step), -height * .5f, c, t);
+
+            auto v3 = addVertex(radius * cosf(angle),        radius * sinf(angle),        +height * .5f, c, t);
+            auto v4 = addVertex(radius * cosf(angle + step), radius * sinf(angle + step), +height * .5f, c, t);
+
+            addTriangle(v1, v3, v2);
+            addTriangle(v2, v3, v4);
+
+            addTriangle(bottomCenter, v1, v2);
+            addTriangle(topCenter, v3, v4);
+        }
+    }
+
+    const TD::ColorTable &m_colors;
+
+    CpuMesh m_mesh;
+};
@@ -0,0 +1,152 @@
+//
+//  MeshRegistry.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "RaylibMesh.h"
+#include "MeshBuilder.h"
+#include "MemoryReport.h"
+#include "MemoryResource.h"
+#include "ThreadPool.h"
+
+using MeshHandle = std::shared_ptr<RayLibMesh>;
+
+// Owns every mesh built for a scene exactly once. Models with the same
+// geometry (the tiles and objects share quite a few) get the same handle.
+// Meshes, their arrays and the handles' control blocks come from the
+// scene's memory, so no handle may outlive it.
+
+class MeshRegistry {
+public:
+    MeshRegistry(const TD::GamePalette &palette, const TD::Scene &scene)
+        : m_palette(palette)
+        , m_scene(scene)
+        , m_memory(scene.memory())
+    { }
+
+    MeshHandle get(const TD::Model &model) {
+        m_requests++;
+
+        if (auto mesh = find(model))
+            return mesh;
+
+        auto mesh = make(RayLibMesh(model, m_palette, m_scene, m_memory));
+        insert(model, mesh);
+
+        return mesh;
+    }
+
+    // Builds the geometry of every model not in the registry yet, spread
+    // over the pool. Nothing is uploaded, see uploadAll().
+    void prebuild(const std::vector<const TD::Model *> &models, ThreadPool &pool = ThreadPool::shared()) {
+        std::vector<const TD::Model *> pending;
+        std::unordered_map<uint64_t, std::vector<const TD::Model *>> seen;
+
+        for (auto model : models) {
+            if (find(*model))
+                continue;
+
+            auto &bucket = seen[model->geometryHash()];
+            auto duplicate = std::any_of(bucket.begin(), bucket.end(), [&](const TD::Model *other) {
+                return other->sameGeometry(*model);
+            });
+
+            if (duplicate)
+                continue;
+
+            bucket.push_back(model);
+            pending.push_back(model);
+        }
+
+        // emplaced, not assigned, so the arrays stay in the scene's memory
+        std::vector<std::optional<CpuMesh>> built(pending.size());
+        auto &colors = m_scene.colorTable(m_palette);
+
+        pool.parallelFor((int)pending.size(), [&](int i) {
+            built[i].emplace(MeshBuilder::build(*pending[i], colors, m_memory));
+        });
+
+        for (int i = 0; i < pending.size(); i++) {
+            insert(*pending[i], make(RayLibMesh(std::move(*built[i]))));
+        }
+    }
+
+    // Main thread only, with the window open
+    void uploadAll() {
+        for (auto &bucket : m_meshes) {
+            for (auto &entry : bucket.second)
+                entry.mesh->load();
+        }
+    }
+
+    int requestCount() const {
+        return m_requests;
+    }
+
+    int uniqueCount() const {
+        return m_uniqueCount;
+    }
+
+    // Every mesh once, named by its geometry hash
+    void accountMemory(MemoryReport &report, const std::string &subsystem) const {
+        for (auto &bucket : m_meshes) {
+            for (auto &entry : bucket.second) {
+                char name[32];
+                snprintf(name, sizeof(name), "mesh %016llx", (unsigned long long)bucket.first);
+
+                report.add(subsystem, name, MemoryReport::Kind::Mesh, entry.mesh->cpuMesh().byteSize());
+                report.add(subsystem, name, MemoryReport::Kind::Gpu, entry.mesh->gpuBytes());
+            }
+        }
+    }
+
+private:
+    MeshHandle make(RayLibMesh &&mesh) const {
+        return std::allocate_shared<RayLibMesh>(ResourceAllocator<RayLibMesh>(m_memory), std::move(mesh));
+    }
+
+    MeshHandle find(const TD::Model &model) const {
+        auto bucket = m_meshes.find(model.geometryHash());
+
+        if (bucket == m_meshes.end())
+            return nullptr;
+
+        for (auto &entry : bucket->second) {
+            if (entry.model->sameGeometry(model))
+                return entry.mesh;
+        }
+
+        return nullptr;
+    }
+
+    void insert(const TD::Model &model, MeshHandle mesh) {
+        m_meshes[model.geometryHash()].push_back({ &model, mesh });
+        m_uniqueCount++;
+    }
+
+    struct Entry {
+        const TD::Model *model;
+        MeshHandle mesh;
+    };
+
+    const TD::GamePalette &m_palette;
+    const TD::Scene &m_scene;
+    MemoryResource *m_memory;
+
+    std::unordered_map<uint64_t, std::vector<Entry>> m_meshes;
+
+    int m_requests = 0;
+    int m_uniqueCount = 0;
+};
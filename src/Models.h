@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "MemoryResource.h"
 #include "ReadUtils.h"
 
 namespace TD {
@@ -19,6 +20,10 @@ struct Point {
     
     Point(int16_t x, int16_t y, int16_t z)
         : x(x), y(y), z(z) { }
+
+    bool operator==(const Point &other) const {
+        return x == other.x && y == other.y && z == other.z;
+    }
 };
 
 class Poly {
@@ -42,6 +47,10 @@ public:
     uint8_t T() const { return a & 0xf800; }
     uint8_t R() const { return d & 0xf800; }
 
+    bool operator==(const Poly &other) const {
+        return a == other.a && b == other.b && c == other.c && d == other.d;
+    }
+
 private:
     uint16_t a, b, c, d;
 };
@@ -50,11 +59,21 @@ struct Sprite {
     uint16_t a, b, c, d;
 };
 
+// The points, polys and sprites come from memory, see Arena
+
 class Model {
 public:
     
-    Model(const std::vector<std::byte> &modelData, int ofs, bool has_lod = false)
+    Model(const std::vector<std::byte> &modelData, int ofs, bool has_lod = false,
+          MemoryResource *memory = MemoryResource::heap())
+        : m_polys(memory)
+        , m_points(memory)
+        , m_sprites(memory)
     {
+        if (ofs < 0 || modelData.size() < ofs + 4) {
+            return;
+        }
+
         auto polyCount    = ReadByte(modelData, ofs);
         auto pointCount   = ReadByte(modelData, ofs);
 
@@ -77,6 +96,10 @@ public:
             x = ReadByte(modelData, ofs);
         }
 
+        if (modelData.size() < (ofs + pointCount * 6 + polyCount * 8 + spritesCount * 8)) {
+            return;
+        }
+
         m_points.resize(pointCount);
 
         for (int i = 0; i < pointCount; i++) {
@@ -91,6 +114,9 @@ public:
             m_points[i].y = (int16_t)ReadWord(modelData, ofs);
         }
 
+        m_polys.reserve(polyCount);
+        m_sprites.reserve(spritesCount);
+
         for (int i = 0; i < polyCount; i++) {
             auto a = ReadWord(modelData, ofs);
             auto b = ReadWord(modelData, ofs);
@@ -112,27 +138,75 @@ public:
 
     }
 
-    const std::vector<Poly>   &polys()  const { return m_polys; };
-    const std::vector<Point>  &points() const { return m_points; };
-    const std::vector<Sprite> &sprites() const { return m_sprites; };
-    
+    const ResourceVector<Poly>   &polys()  const { return m_polys; };
+    const ResourceVector<Point>  &points() const { return m_points; };
+    const ResourceVector<Sprite> &sprites() const { return m_sprites; };
+
+    long long byteSize() const {
+        return m_polys.size()   * sizeof(Poly)
+             + m_points.size()  * sizeof(Point)
+             + m_sprites.size() * sizeof(Sprite);
+    }
+
+    // Meshes only depend on points and polys, sprites are not part of it
+    bool sameGeometry(const Model &other) const {
+        return m_points == other.m_points && m_polys == other.m_polys;
+    }
+
+    uint64_t geometryHash() const {
+        // FNV-1a over the raw point and poly words
+        uint64_t h = 0xcbf29ce484222325;
+
+        auto mix = [&h](uint16_t word) {
+            h = (h ^ (word & 0xff)) * 0x100000001b3;
+            h = (h ^ (word >> 8))   * 0x100000001b3;
+        };
+
+        mix(m_points.size());
+        mix(m_polys.size());
+
+        for (auto &p : m_points) {
+            mix(p.x);
+            mix(p.y);
+            mix(p.z);
+        }
+
+        for (auto &p : m_polys) {
+            mix(p.type());
+            mix(p.idx0()); mix(p.idx1()); mix(p.idx2()); mix(p.idx3());
+            mix(p.color0());
+            mix(p.color1());
+        }
+
+        return h;
+    }
+
 private:
-    std::vector<Poly> m_polys;
-    std::vector<Point> m_points;
-    std::vector<Sprite> m_sprites;
+    ResourceVector<Poly> m_polys;
+    ResourceVector<Point> m_points;
+    ResourceVector<Sprite> m_sprites;
 };
 
 
-inline Model LoadModel(const std::vector<std::byte> data, const int idx, bool has_lod = false)
+inline Model LoadModel(const std::vector<std::byte> data, const int idx, bool has_lod = false,
+                       MemoryResource *memory = MemoryResource::heap())
 {
     auto offset = GetWord(data, idx * 2);
-    return Model(data, offset, has_lod);
+    return Model(data, offset, has_lod, memory);
 }
 
 
-inline std::vector<Model> LoadModels(const std::vector<std::byte> data, const int count, bool has_lod = false)
+inline std::vector<Model> LoadModels(const std::vector<std::byte> &data, const int count, bool has_lod = false,
+                                     MemoryResource *memory = MemoryResource::heap())
 {
+    // models running past the end come out empty, as the stock data has
+    // some; an offset table or a model that is not there at all is bad data
+    if (data.size() < count * 2) {
+        throw BadData("model offsets past the end of the file");
+    }
+
     std::vector<Model> res;
+    res.reserve(count);
     
     int i = 0;
     
@@ -145,13 +219,17 @@ inline std::vector<Model> LoadModels(const std::vector<std::byte> data, const in
     for (int k = 0; k < count; k++) {
         auto offset = ReadWord(data, i);
         
-        if (offset < 0x10) {
+        if (offset < 0x10 && k > 0) {
             auto j = i - 4;
             offset = ReadWord(data, j);
         }
+
+        if (data.size() < offset + 4) {
+            throw BadData("model past the end of the file");
+        }
         
-        auto tile = Model(data, offset, has_lod);
-        res.push_back(tile);
+        // moved, a copy would allocate from the default resource
+        res.push_back(Model(data, offset, has_lod, memory));
     }
 
     return res;
@@ -0,0 +1,427 @@
+//
+//  OcclusionBuffer.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <rlgl.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "Culling.h"
+#include "MeshBuilder.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TD_OCCLUSION_SSE2 1
+#else
+#define TD_OCCLUSION_SSE2 0
+#endif
+
+// World space triangles of the meshes that can hide others, grouped by an
+// index (the tile) so a frame can pick the ones near the camera. Vertices
+// in the same place are stored once, and slivers that hide nothing are
+// left out.
+class OccluderSet {
+public:
+    // In square world units, about a thousandth of a tile
+    static constexpr float MinArea = .001f;
+
+    struct Group {
+        std::vector<Vector3> vertices;
+        std::vector<uint16_t> indices;
+    };
+
+    void clear() {
+        m_groups.clear();
+    }
+
+    void add(int group, const CpuMesh &mesh, const Matrix &transform) {
+        if (group >= m_groups.size())
+            m_groups.resize(group + 1);
+
+        auto &occluder = m_groups[group];
+        std::map<std::tuple<float, float, float>, uint16_t> shared;
+
+        auto vertex = [&](Vector3 v) {
+            auto found = shared.emplace(std::make_tuple(v.x, v.y, v.z), (uint16_t)occluder.vertices.size());
+
+            if (found.second)
+                occluder.vertices.push_back(v);
+
+            return found.first->second;
+        };
+
+        for (int i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            Vector3 world[3];
+
+            for (int k = 0; k < 3; k++) {
+                auto v = mesh.indices[i + k] * 3;
+                world[k] = Vector3Transform({ mesh.vertices[v], mesh.vertices[v + 1], mesh.vertices[v + 2] }, transform);
+            }
+
+            auto cross = Vector3CrossProduct(Vector3Subtract(world[1], world[0]), Vector3Subtract(world[2], world[0]));
+
+            if (Vector3Length(cross) / 2 < MinArea)
+                continue;
+
+            for (auto &v : world)
+                occluder.indices.push_back(vertex(v));
+        }
+    }
+
+    const Group &group(int group) const {
+        return m_groups[group];
+    }
+
+    int groupCount() const {
+        return (int)m_groups.size();
+    }
+
+private:
+    std::vector<Group> m_groups;
+};
+
+// A small depth buffer, filled with a few occluders and then asked whether
+// bounding boxes are hidden behind them. Depth is z/w as the GL path
+// computes it; a pixel keeps the nearest occluder at its centre.
+//
+// isVisible() is conservative: it answers false only when every pixel
+// under the box's screen rectangle holds something nearer than the box's
+// nearest corner. end() widens what pixel centres miss at the occluders'
+// edges, and boxes through the near plane are always visible.
+//
+// Row spans are filled and tested four pixels at a time with SSE2, with a
+// scalar fallback that gives the same answers.
+
+class OcclusionBuffer {
+public:
+    static const int Width = 256;
+    static const int Height = 160;
+
+    OcclusionBuffer()
+        : m_depth(Width * Height)
+    {
+        m_viewProjection = MatrixIdentity();
+    }
+
+    // Matches the projection BeginMode3D sets up for a perspective camera
+    void begin(const Camera &camera, float aspect) {
+        auto view = MatrixLookAt(camera.position, camera.target, camera.up);
+        auto projection = MatrixPerspective(camera.fovy * DEG2RAD,
+                                            aspect,
+                                            RL_CULL_DISTANCE_NEAR,
+                                            RL_CULL_DISTANCE_FAR);
+
+        m_viewProjection = MatrixMultiply(view, projection);
+        std::fill(m_depth.begin(), m_depth.end(), std::numeric_limits<float>::infinity());
+
+        m_triangles = 0;
+    }
+
+    void drawOccluder(const OccluderSet::Group &occluder) {
+        m_clipVertices.resize(occluder.vertices.size());
+
+        for (int i = 0; i < occluder.vertices.size(); i++)
+            m_clipVertices[i] = project(occluder.vertices[i]);
+
+        auto &indices = occluder.indices;
+
+        for (int i = 0; i + 2 < indices.size(); i += 3) {
+            clipTriangle(m_clipVertices[indices[i + 0]],
+                         m_clipVertices[indices[i + 1]],
+                         m_clipVertices[indices[i + 2]]);
+        }
+    }
+
+    // After the last occluder, before the first test. Every pixel takes the
+    // farthest depth of the 3x3 around it: a pixel whose centre an occluder
+    // covers may still show what is behind it near the occluder's edges.
+    void end() {
+        m_scratch.resize(m_depth.size());
+
+        // along the rows into m_scratch, then down the columns back
+        for (int y = 0; y < Height; y++) {
+            auto row = m_depth.data() + y * Width;
+            auto out = m_scratch.data() + y * Width;
+
+            out[0] = std::max(row[0], row[1]);
+            out[Width - 1] = std::max(row[Width - 2], row[Width - 1]);
+
+            farthest(row, row + 1, row + 2, out + 1, Width - 2);
+        }
+
+        std::copy(m_scratch.begin(), m_scratch.begin() + Width, m_depth.begin());
+        std::copy(m_scratch.end() - Width, m_scratch.end(), m_depth.end() - Width);
+
+        farthest(m_scratch.data(), m_scratch.data() + Width, m_scratch.data() + 2 * Width,
+                 m_depth.data() + Width, (Height - 2) * Width);
+
+        for (int x = 0; x < Width; x++) {
+            m_depth[x] = std::max(m_depth[x], m_scratch[Width + x]);
+            m_depth[(Height - 1) * Width + x] = std::max(m_depth[(Height - 1) * Width + x], m_scratch[(Height - 2) * Width + x]);
+        }
+    }
+
+    bool isVisible(const BoundingBox &box) const {
+        float minX = Width, minY = Height, maxX = 0, maxY = 0;
+        float nearest = std::numeric_limits<float>::infinity();
+
+        for (int i = 0; i < 8; i++) {
+            auto v = project({
+                (i & 1) ? box.max.x : box.min.x,
+                (i & 2) ? box.max.y : box.min.y,
+                (i & 4) ? box.max.z : box.min.z,
+            });
+
+            if (v.z < -v.w)
+                return true;
+
+            auto screen = toScreen(v);
+
+            minX = std::min(minX, screen.x);
+            minY = std::min(minY, screen.y);
+            maxX = std::max(maxX, screen.x);
+            maxY = std::max(maxY, screen.y);
+            nearest = std::min(nearest, screen.z);
+        }
+
+        auto x0 = std::max(0,          (int)std::floor(minX));
+        auto y0 = std::max(0,          (int)std::floor(minY));
+        auto x1 = std::min(Width - 1,  (int)std::ceil (maxX));
+        auto y1 = std::min(Height - 1, (int)std::ceil (maxY));
+
+        // off screen, the frustum decides
+        if (x0 > x1 || y0 > y1)
+            return true;
+
+        for (int y = y0; y <= y1; y++) {
+            if (!rowHidden(y, x0, x1 + 1, nearest))
+                return true;
+        }
+
+        return false;
+    }
+
+    // Occluder triangles rasterized since begin()
+    int triangleCount() const {
+        return m_triangles;
+    }
+
+    // Rows top first, infinity where nothing was drawn
+    const float *depth() const {
+        return m_depth.data();
+    }
+
+private:
+    struct ClipVertex {
+        float x, y, z, w;
+    };
+
+    ClipVertex project(Vector3 v) const {
+        auto &m = m_viewProjection;
+
+        return {
+            m.m0 * v.x + m.m4 * v.y + m.m8  * v.z + m.m12,
+            m.m1 * v.x + m.m5 * v.y + m.m9  * v.z + m.m13,
+            m.m2 * v.x + m.m6 * v.y + m.m10 * v.z + m.m14,
+            m.m3 * v.x + m.m7 * v.y + m.m11 * v.z + m.m15,
+        };
+    }
+
+    static Vector3 toScreen(const ClipVertex &v) {
+        return {
+            (v.x / v.w * .5f + .5f) * Width,
+            (.5f - v.y / v.w * .5f) * Height,
+            v.z / v.w,
+        };
+    }
+
+    // Only the near plane needs clipping, the rest is the bounding rectangle
+    void clipTriangle(ClipVertex v0, ClipVertex v1, ClipVertex v2) {
+        auto outside = [&](auto distance) {
+            return distance(v0) < 0 && distance(v1) < 0 && distance(v2) < 0;
+        };
+
+        if (outside([](auto &v) { return v.w - v.x; }) ||
+            outside([](auto &v) { return v.w + v.x; }) ||
+            outside([](auto &v) { return v.w - v.y; }) ||
+            outside([](auto &v) { return v.w + v.y; }) ||
+            outside([](auto &v) { return v.z + v.w; }))
+        {
+            return;
+        }
+
+        ClipVertex in[3] = { v0, v1, v2 };
+        ClipVertex polygon[4];
+        int count = 0;
+
+        for (int i = 0; i < 3; i++) {
+            auto &a = in[i];
+            auto &b = in[(i + 1) % 3];
+            auto da = a.z + a.w;
+            auto db = b.z + b.w;
+
+            if (da >= 0)
+                polygon[count++] = a;
+
+            if ((da >= 0) != (db >= 0)) {
+                auto t = da / (da - db);
+
+                polygon[count++] = {
+                    a.x + (b.x - a.x) * t,
+                    a.y + (b.y - a.y) * t,
+                    a.z + (b.z - a.z) * t,
+                    a.w + (b.w - a.w) * t,
+                };
+            }
+        }
+
+        Vector3 screen[4];
+
+        for (int i = 0; i < count; i++)
+            screen[i] = toScreen(polygon[i]);
+
+        for (int i = 1; i + 1 < count; i++)
+            rasterize(screen[0], screen[i], screen[i + 1]);
+    }
+
+    // Edge i is a[i] * x + b[i] * y + c[i], not negative inside. Each row
+    // solves the edges for its span and only fills that. Pixels on an edge
+    // shared by two triangles get drawn twice, harmless for depth.
+    void rasterize(Vector3 v0, Vector3 v1, Vector3 v2) {
+        auto area = (v2.x - v0.x) * (v1.y - v0.y) - (v2.y - v0.y) * (v1.x - v0.x);
+
+        if (area == 0)
+            return;
+
+        if (area < 0) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        // pixels whose centres the bounds hold, most small triangles have none
+        auto minX = std::max(0,          (int)std::ceil (std::min({ v0.x, v1.x, v2.x }) - .5f));
+        auto minY = std::max(0,          (int)std::ceil (std::min({ v0.y, v1.y, v2.y }) - .5f));
+        auto maxX = std::min(Width - 1,  (int)std::floor(std::max({ v0.x, v1.x, v2.x }) - .5f));
+        auto maxY = std::min(Height - 1, (int)std::floor(std::max({ v0.y, v1.y, v2.y }) - .5f));
+
+        if (minX > maxX || minY > maxY)
+            return;
+
+        Vector3 v[3] = { v0, v1, v2 };
+        float a[3], b[3], c[3], inverseA[3];
+        float za = 0, zb = 0, zc = 0;
+        auto inverseArea = 1 / area;
+
+        for (int i = 0; i < 3; i++) {
+            auto &from = v[(i + 1) % 3];
+            auto &to = v[(i + 2) % 3];
+
+            a[i] = to.y - from.y;
+            b[i] = from.x - to.x;
+            c[i] = -from.x * a[i] - from.y * b[i];
+
+            inverseA[i] = a[i] != 0 ? 1 / a[i] : 0;
+
+            za += a[i] * v[i].z * inverseArea;
+            zb += b[i] * v[i].z * inverseArea;
+            zc += c[i] * v[i].z * inverseArea;
+        }
+
+        for (int y = minY; y <= maxY; y++) {
+            auto py = y + .5f;
+            auto depth = m_depth.data() + y * Width;
+
+            // the pixels whose centres are inside all three edges
+            auto begin = (float)minX;
+            auto end = (float)maxX + 1;
+
+            for (int i = 0; i < 3; i++) {
+                auto row = b[i] * py + c[i];
+
+                if (a[i] > 0)
+                    begin = std::max(begin, std::ceil(-row * inverseA[i] - .5f));
+                else if (a[i] < 0)
+                    end = std::min(end, std::floor(-row * inverseA[i] - .5f) + 1);
+                else if (row < 0)
+                    end = begin;
+            }
+
+            auto x = (int)begin;
+            auto zRow = zb * py + zc;
+
+#if TD_OCCLUSION_SSE2
+            const auto lanes = _mm_setr_ps(.5f, 1.5f, 2.5f, 3.5f);
+            const auto zaa = _mm_set1_ps(za);
+            const auto zr = _mm_set1_ps(zRow);
+
+            for (; x + 4 <= end; x += 4) {
+                auto px = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+                auto z = _mm_add_ps(_mm_mul_ps(zaa, px), zr);
+
+                _mm_storeu_ps(depth + x, _mm_min_ps(z, _mm_loadu_ps(depth + x)));
+            }
+#endif
+
+            for (; x < end; x++)
+                depth[x] = std::min(depth[x], za * (x + .5f) + zRow);
+        }
+
+        m_triangles++;
+    }
+
+    // out[i] = max(a[i], b[i], c[i])
+    static void farthest(const float *a, const float *b, const float *c, float *out, int count) {
+        int i = 0;
+
+#if TD_OCCLUSION_SSE2
+        for (; i + 4 <= count; i += 4) {
+            auto m = _mm_max_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+            _mm_storeu_ps(out + i, _mm_max_ps(m, _mm_loadu_ps(c + i)));
+        }
+#endif
+
+        for (; i < count; i++)
+            out[i] = std::max({ a[i], b[i], c[i] });
+    }
+
+    // Every pixel of the row's [begin, end) holds something nearer than z
+    bool rowHidden(int y, int begin, int end, float z) const {
+        auto depth = m_depth.data() + y * Width;
+        int x = begin;
+
+#if TD_OCCLUSION_SSE2
+        const auto limit = _mm_set1_ps(z);
+
+        for (; x + 4 <= end; x += 4) {
+            if (_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(depth + x), limit)) != 0xf)
+                return false;
+        }
+#endif
+
+        for (; x < end; x++) {
+            if (!(depth[x] < z))
+                return false;
+        }
+
+        return true;
+    }
+
+    Matrix m_viewProjection;
+    std::vector<float> m_depth;
+    std::vector<float> m_scratch;
+    std::vector<ClipVertex> m_clipVertices;
+    int m_triangles = 0;
+};
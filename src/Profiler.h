@@ -0,0 +1,311 @@
+//
+//  Profiler.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Per frame timings of named sections plus draw counters, shown as an
+// overlay and optionally captured to a Chrome trace (chrome://tracing or
+// ui.perfetto.dev). Main thread only.
+//
+// Disabled it costs one branch per scope or counter.
+
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static const int HistoryFrames = 120;
+
+    enum Counter {
+        DrawCalls,
+        Triangles,
+        TextureBinds,
+        CounterCount,
+    };
+
+    static Profiler &shared() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    bool enabled() const {
+        return m_enabled;
+    }
+
+    void setEnabled(bool enabled) {
+        m_enabled = enabled;
+    }
+
+    void beginFrame() {
+        if (!m_enabled)
+            return;
+
+        m_frameStart = Clock::now();
+        m_counters.fill(0);
+
+        for (auto &section : m_sections)
+            section.frameTotal = 0;
+    }
+
+    void endFrame() {
+        if (!m_enabled)
+            return;
+
+        auto end = Clock::now();
+        add("frame", m_frameStart, end);
+
+        for (auto &section : m_sections)
+            section.history[m_frame % HistoryFrames] = section.frameTotal;
+
+        for (int i = 0; i < CounterCount; i++)
+            m_counterHistory[i][m_frame % HistoryFrames] = (float)m_counters[i];
+
+        if (m_captureFrames > 0) {
+            for (int i = 0; i < CounterCount; i++)
+                m_captureCounters.push_back({ i, microseconds(end), m_counters[i] });
+
+            if (--m_captureFrames == 0)
+                writeCapture();
+        }
+
+        m_frame++;
+    }
+
+    void add(const char *name, Clock::time_point start, Clock::time_point end) {
+        auto &section = sectionNamed(name);
+        section.frameTotal += std::chrono::duration<float, std::milli>(end - start).count();
+
+        if (m_captureFrames > 0)
+            m_captureEvents.push_back({ name, microseconds(start), microseconds(end) - microseconds(start) });
+    }
+
+    void count(Counter counter, int amount = 1) {
+        if (m_enabled)
+            m_counters[counter] += amount;
+    }
+
+    void countDraw(int triangles) {
+        count(DrawCalls);
+        count(Triangles, triangles);
+    }
+
+    // Records the next frames and writes them to path when done
+    void capture(int frames, const std::string &path) {
+        m_enabled = true;
+        m_captureFrames = frames;
+        m_capturePath = path;
+        m_captureStart = Clock::now();
+        m_captureEvents.clear();
+        m_captureCounters.clear();
+    }
+
+    bool isCapturing() const {
+        return m_captureFrames > 0;
+    }
+
+    // Each section's time in the frame endFrame() last closed, zero for
+    // those it did not enter
+    template <typename Visit>
+    void visitLastFrame(Visit visit) const {
+        for (auto &section : m_sections)
+            visit(section.name, section.frameTotal);
+    }
+
+    int lastFrameCount(Counter counter) const {
+        return m_counters[counter];
+    }
+
+    static const char *CounterName(int counter) {
+        const char *names[CounterCount] = { "draw calls", "triangles", "texture binds" };
+        return names[counter];
+    }
+
+    void drawOverlay(int x, int y) const {
+        if (!m_enabled)
+            return;
+
+        const int FontSize = 10;
+        const int LineHeight = 12;
+
+        auto lines = (int)m_sections.size() + CounterCount + 1;
+        DrawRectangle(x - 4, y - 4, 260, lines * LineHeight + 8, Fade(::BLACK, .6f));
+
+        char line[100];
+
+        snprintf(line, sizeof(line), "%-18s %7s %7s", "SECTION", "AVG MS", "P99 MS");
+        DrawText(line, x, y, FontSize, ::LIGHTGRAY);
+        y += LineHeight;
+
+        for (auto &section : m_sections) {
+            auto stats = summarize(section.history);
+
+            snprintf(line, sizeof(line), "%-18s %7.2f %7.2f", section.name, stats.average, stats.p99);
+            DrawText(line, x, y, FontSize, ::WHITE);
+            y += LineHeight;
+        }
+
+        for (int i = 0; i < CounterCount; i++) {
+            auto stats = summarize(m_counterHistory[i]);
+
+            snprintf(line, sizeof(line), "%-18s %7.0f %7.0f", CounterName(i), stats.average, stats.p99);
+            DrawText(line, x, y, FontSize, ::YELLOW);
+            y += LineHeight;
+        }
+    }
+
+private:
+    using History = std::array<float, HistoryFrames>;
+
+    struct Section {
+        const char *name;
+        float frameTotal;
+        History history;
+    };
+
+    struct Event {
+        const char *name;
+        long long start;
+        long long duration;
+    };
+
+    struct CounterSample {
+        int counter;
+        long long time;
+        int value;
+    };
+
+    struct Summary {
+        float average;
+        float p99;
+    };
+
+    Profiler() {
+        for (auto &history : m_counterHistory)
+            history.fill(0);
+    }
+
+    Section &sectionNamed(const char *name) {
+        // scope names are literals, compare the pointers first
+        for (auto &section : m_sections) {
+            if (section.name == name)
+                return section;
+        }
+
+        for (auto &section : m_sections) {
+            if (strcmp(section.name, name) == 0)
+                return section;
+        }
+
+        m_sections.push_back({ name, 0, {} });
+        return m_sections.back();
+    }
+
+    Summary summarize(const History &history) const {
+        auto frames = std::min(m_frame, (long long)HistoryFrames);
+
+        if (frames == 0)
+            return { 0, 0 };
+
+        auto sorted = std::vector<float>(history.begin(), history.begin() + frames);
+        auto p99 = sorted.begin() + (frames * 99) / 100;
+
+        std::nth_element(sorted.begin(), p99, sorted.end());
+
+        float total = 0;
+        for (auto value : sorted)
+            total += value;
+
+        return { total / frames, *p99 };
+    }
+
+    long long microseconds(Clock::time_point time) const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time - m_captureStart).count();
+    }
+
+    void writeCapture() {
+        auto file = fopen(m_capturePath.c_str(), "w");
+
+        if (!file) {
+            printf("[profiler] can't write %s\n", m_capturePath.c_str());
+            return;
+        }
+
+        fprintf(file, "{\"traceEvents\":[\n");
+
+        auto separator = "";
+
+        for (auto &event : m_captureEvents) {
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":0,\"tid\":0}",
+                    separator, event.name, event.start, event.duration);
+            separator = ",\n";
+        }
+
+        for (auto &sample : m_captureCounters) {
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%lld,\"pid\":0,\"args\":{\"value\":%d}}",
+                    separator, CounterName(sample.counter), sample.time, sample.value);
+            separator = ",\n";
+        }
+
+        fprintf(file, "\n]}\n");
+        fclose(file);
+
+        printf("[profiler] wrote %zu events to %s\n", m_captureEvents.size(), m_capturePath.c_str());
+
+        m_captureEvents.clear();
+        m_captureCounters.clear();
+    }
+
+    bool m_enabled = false;
+    long long m_frame = 0;
+    Clock::time_point m_frameStart;
+
+    std::vector<Section> m_sections;
+    std::array<int, CounterCount> m_counters = { 0 };
+    std::array<History, CounterCount> m_counterHistory;
+
+    int m_captureFrames = 0;
+    std::string m_capturePath;
+    Clock::time_point m_captureStart;
+    std::vector<Event> m_captureEvents;
+    std::vector<CounterSample> m_captureCounters;
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char *name)
+        : m_name(Profiler::shared().enabled() ? name : nullptr)
+    {
+        if (m_name)
+            m_start = Profiler::Clock::now();
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+    ~ProfileScope() {
+        if (m_name)
+            Profiler::shared().add(m_name, m_start, Profiler::Clock::now());
+    }
+
+private:
+    const char *m_name;
+    Profiler::Clock::time_point m_start;
+};
+
+#define TD_PROFILE_CONCAT_INNER(a, b) a##b
+#define TD_PROFILE_CONCAT(a, b) TD_PROFILE_CONCAT_INNER(a, b)
+
+#define TD_PROFILE_SCOPE(name) ProfileScope TD_PROFILE_CONCAT(profileScope, __LINE__)(name)
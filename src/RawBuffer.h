@@ -0,0 +1,100 @@
+//
+//  RawBuffer.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace TD {
+
+// What to do with archive files once what they decode to exists
+enum class RawPolicy {
+    Keep,
+    DropAfterDecode,
+};
+
+// A file out of the game's archives, read on first use. Once its decoded
+// products exist the owner calls decoded(), which lets the bytes go under
+// RawPolicy::DropAfterDecode; asking for them again reads them back.
+//
+// Reads are serialised and get() hands out the bytes shared, alive for as
+// long as the caller holds them whatever drops meanwhile, so decoders on
+// different threads can share one.
+
+class RawBuffer {
+public:
+    using Fetch = std::function<std::vector<std::byte>()>;
+    using Bytes = std::shared_ptr<const std::vector<std::byte>>;
+
+    RawBuffer()
+        : RawBuffer([] { return std::vector<std::byte>(); })
+    { }
+
+    RawBuffer(Fetch fetch, RawPolicy policy = RawPolicy::DropAfterDecode)
+        : m_state(std::make_unique<State>())
+    {
+        m_state->fetch = std::move(fetch);
+        m_state->policy = policy;
+    }
+
+    Bytes get() const {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+
+        if (!m_state->data) {
+            m_state->data = std::make_shared<const std::vector<std::byte>>(m_state->fetch());
+            m_state->fetches++;
+        }
+
+        return m_state->data;
+    }
+
+    void decoded() const {
+        if (m_state->policy == RawPolicy::DropAfterDecode)
+            drop();
+    }
+
+    void drop() const {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+
+        m_state->data.reset();
+    }
+
+    bool isLoaded() const {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        return m_state->data != nullptr;
+    }
+
+    // Held right now, 0 while dropped even if a caller still has them
+    long long bytes() const {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        return m_state->data ? (long long)m_state->data->size() : 0;
+    }
+
+    // Times it was read from disk, more than one means it was dropped too early
+    int fetchCount() const {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        return m_state->fetches;
+    }
+
+private:
+    struct State {
+        Fetch fetch;
+        RawPolicy policy;
+        std::mutex mutex;
+        Bytes data;
+        int fetches = 0;
+    };
+
+    std::unique_ptr<State> m_state;
+};
+
+}
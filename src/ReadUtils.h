@@ -9,9 +9,16 @@
 
 #include <vector>
 #include <cstdint>
+#include <stdexcept>
 
 namespace TD {
 
+// Data too short for what it should hold, like a file half written by
+// whoever is editing it
+struct BadData : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
 inline uint8_t ReadByte(const std::vector<std::byte> &src, int &i) {
     return std::to_integer<uint8_t>(src[i++]);
 };
@@ -0,0 +1,350 @@
+//
+//  RenderBackend.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <rlgl.h>
+
+#include <array>
+#include <vector>
+
+#include "BillboardBatch.h"
+#include "CourseSprites.h"
+#include "GameImage.h"
+#include "Profiler.h"
+#include "RaylibMesh.h"
+#include "SoftwareRenderer.h"
+#include "TextLabels.h"
+
+// What the screens submit, so the traversal can run without a window.
+//
+// Transforms pushed with pushMatrix() apply to everything drawn until the
+// matching popMatrix(), like rlPushMatrix() and friends. Resources are
+// only uploaded by the raylib backend.
+
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+
+    virtual void beginFrame(Color background) = 0;
+    virtual void endFrame() = 0;
+
+    virtual void beginMode3D(const Camera &camera) = 0;
+    virtual void endMode3D() = 0;
+
+    virtual void pushMatrix(const Matrix &transform) = 0;
+    virtual void popMatrix() = 0;
+
+    virtual void drawMesh(RayLibMesh &mesh, const Matrix &transform) = 0;
+    // All of them with the sprites' atlas, see BillboardBatch
+    virtual void drawBillboards(const BillboardQuads &quads, CourseSprites &sprites) = 0;
+    // Upscaled on the CPU, see ImageScaler
+    virtual void drawImage(const TD::GameImage &image, int x, int y, int scale, TD::ImageScaler::Filter filter) = 0;
+
+    void drawTexture(const TD::GameImage &image, int x, int y) {
+        drawImage(image, x, y, 1, TD::ImageScaler::Filter::Nearest);
+    }
+
+    virtual void drawBoundingBox(const BoundingBox &box, Color color) = 0;
+    virtual void drawGrid(int slices, float spacing) = 0;
+    virtual void drawSphere(Vector3 center, float radius, Color color) = 0;
+    virtual void drawCylinder(Vector3 position, float radius, float height, Color color) = 0;
+
+    virtual void drawText(const char *text, int x, int y, int fontSize, Color color) = 0;
+    virtual void drawLabels(TextLabels &labels) = 0;
+};
+
+class RaylibBackend: public RenderBackend {
+public:
+    int width() const override  { return GetScreenWidth(); }
+    int height() const override { return GetScreenHeight(); }
+
+    void beginFrame(Color background) override {
+        BeginDrawing();
+        ClearBackground(background);
+    }
+
+    void endFrame() override {
+        Profiler::shared().drawOverlay(GetScreenWidth() - 270, 10);
+        EndDrawing();
+    }
+
+    void beginMode3D(const Camera &camera) override {
+        BeginMode3D(camera);
+    }
+
+    void endMode3D() override {
+        EndMode3D();
+    }
+
+    void pushMatrix(const Matrix &transform) override {
+        rlPushMatrix();
+        rlMultMatrixf(MatrixToFloat(transform));
+    }
+
+    void popMatrix() override {
+        rlPopMatrix();
+    }
+
+    void drawMesh(RayLibMesh &mesh, const Matrix &transform) override {
+        mesh.draw(transform);
+    }
+
+    // Fed to rlgl a slice at a time, so it only flushes when its batch
+    // buffer is full; the atlas stays bound throughout
+    void drawBillboards(const BillboardQuads &quads, CourseSprites &sprites) override {
+        const int QuadsPerSlice = 1024;
+
+        auto count = quads.count();
+
+        if (count == 0)
+            return;
+
+        auto texture = sprites.atlasTexture();
+        Profiler::shared().countDraw(count * 2);
+
+        for (int first = 0; first < count; first += QuadsPerSlice) {
+            auto last = first + QuadsPerSlice < count ? first + QuadsPerSlice : count;
+
+            rlCheckRenderBatchLimit((last - first) * 4);
+            rlSetTexture(texture.id);
+
+            rlBegin(RL_QUADS);
+            rlColor4ub(255, 255, 255, 255);
+
+            for (int v = first * 4; v < last * 4; v++) {
+                rlTexCoord2f(quads.texcoords[v * 2], quads.texcoords[v * 2 + 1]);
+                rlVertex3f(quads.vertices[v * 3], quads.vertices[v * 3 + 1], quads.vertices[v * 3 + 2]);
+            }
+
+            rlEnd();
+        }
+
+        rlSetTexture(0);
+    }
+
+    void drawImage(const TD::GameImage &image, int x, int y, int scale, TD::ImageScaler::Filter filter) override {
+        Profiler::shared().countDraw(2);
+        DrawTexture(image.texture(scale, filter), x, y, ::WHITE);
+    }
+
+    void drawBoundingBox(const BoundingBox &box, Color color) override {
+        DrawBoundingBox(box, color);
+    }
+
+    void drawGrid(int slices, float spacing) override {
+        DrawGrid(slices, spacing);
+    }
+
+    void drawSphere(Vector3 center, float radius, Color color) override {
+        DrawSphere(center, radius, color);
+    }
+
+    void drawCylinder(Vector3 position, float radius, float height, Color color) override {
+        DrawCylinder(position, radius, radius, height, 16, color);
+    }
+
+    void drawText(const char *text, int x, int y, int fontSize, Color color) override {
+        DrawText(text, x, y, fontSize, color);
+    }
+
+    void drawLabels(TextLabels &labels) override {
+        TD_PROFILE_SCOPE("labels");
+        labels.draw();
+    }
+};
+
+struct RenderCommand {
+    enum Type {
+        Mesh,
+        Billboard,
+        Texture,
+        BoundingBox,
+        Grid,
+        Sphere,
+        Cylinder,
+        Text,
+        Labels,
+        TypeCount,
+    };
+
+    Type type;
+    const void *resource;   // the mesh, sprites, image or labels, if any
+    Matrix transform;       // with the pushed matrices applied
+    Vector3 position;
+    int triangles;
+};
+
+// Keeps count of what was submitted each frame and draws nothing
+class NullBackend: public RenderBackend {
+public:
+    NullBackend(int width, int height)
+        : m_width(width)
+        , m_height(height)
+    { }
+
+    int width() const override  { return m_width; }
+    int height() const override { return m_height; }
+
+    void beginFrame(Color) override {
+        m_counts.fill(0);
+        m_triangles = 0;
+        m_stack.assign(1, MatrixIdentity());
+    }
+
+    void endFrame() override { }
+
+    void beginMode3D(const Camera &) override { }
+    void endMode3D() override { }
+
+    void pushMatrix(const Matrix &transform) override {
+        m_stack.push_back(MatrixMultiply(transform, m_stack.back()));
+    }
+
+    void popMatrix() override {
+        m_stack.pop_back();
+    }
+
+    void drawMesh(RayLibMesh &mesh, const Matrix &transform) override {
+        submit(RenderCommand::Mesh, &mesh, transform, { 0 }, mesh.cpuMesh().triangleCount());
+    }
+
+    void drawBillboards(const BillboardQuads &quads, CourseSprites &sprites) override {
+        submit(RenderCommand::Billboard, &sprites, MatrixIdentity(), { 0 }, quads.count() * 2);
+    }
+
+    void drawImage(const TD::GameImage &image, int x, int y, int, TD::ImageScaler::Filter) override {
+        submit(RenderCommand::Texture, &image, MatrixIdentity(), { (float)x, (float)y, 0 }, 2);
+    }
+
+    void drawBoundingBox(const BoundingBox &box, Color) override {
+        submit(RenderCommand::BoundingBox, nullptr, MatrixIdentity(), box.min, 0);
+    }
+
+    void drawGrid(int, float) override {
+        submit(RenderCommand::Grid, nullptr, MatrixIdentity(), { 0 }, 0);
+    }
+
+    void drawSphere(Vector3 center, float, Color) override {
+        submit(RenderCommand::Sphere, nullptr, MatrixIdentity(), center, 0);
+    }
+
+    void drawCylinder(Vector3 position, float, float, Color) override {
+        submit(RenderCommand::Cylinder, nullptr, MatrixIdentity(), position, 0);
+    }
+
+    void drawText(const char *, int x, int y, int, Color) override {
+        submit(RenderCommand::Text, nullptr, MatrixIdentity(), { (float)x, (float)y, 0 }, 0);
+    }
+
+    void drawLabels(TextLabels &labels) override {
+        submit(RenderCommand::Labels, &labels, MatrixIdentity(), { 0 }, labels.glyphCount() * 2);
+    }
+
+    // Of the current frame
+    int count(RenderCommand::Type type) const {
+        return m_counts[type];
+    }
+
+    int drawCount() const {
+        int total = 0;
+
+        for (auto count : m_counts)
+            total += count;
+
+        return total;
+    }
+
+    long long triangles() const {
+        return m_triangles;
+    }
+
+protected:
+    virtual void record(const RenderCommand &) { }
+
+    const Matrix &currentMatrix() const {
+        return m_stack.back();
+    }
+
+private:
+    void submit(RenderCommand::Type type, const void *resource, const Matrix &transform, Vector3 position, int triangles) {
+        m_counts[type]++;
+        m_triangles += triangles;
+
+        record({ type, resource, MatrixMultiply(transform, m_stack.back()), position, triangles });
+    }
+
+    int m_width;
+    int m_height;
+
+    std::array<int, RenderCommand::TypeCount> m_counts = { 0 };
+    long long m_triangles = 0;
+    std::vector<Matrix> m_stack = { MatrixIdentity() };
+};
+
+// Also keeps the commands of the last frame, in submission order
+class RecordingBackend: public NullBackend {
+public:
+    using NullBackend::NullBackend;
+
+    void beginFrame(Color background) override {
+        NullBackend::beginFrame(background);
+        m_commands.clear();
+    }
+
+    const std::vector<RenderCommand> &commands() const {
+        return m_commands;
+    }
+
+protected:
+    void record(const RenderCommand &command) override {
+        m_commands.push_back(command);
+    }
+
+private:
+    std::vector<RenderCommand> m_commands;
+};
+
+// Meshes go to a SoftwareRenderer, everything else is only counted
+class SoftwareBackend: public NullBackend {
+public:
+    SoftwareBackend(int width, int height)
+        : NullBackend(width, height)
+        , m_renderer(width, height)
+    { }
+
+    SoftwareRenderer &renderer() {
+        return m_renderer;
+    }
+
+    void beginFrame(Color background) override {
+        NullBackend::beginFrame(background);
+        m_renderer.clear(background);
+    }
+
+    void endFrame() override {
+        TD_PROFILE_SCOPE("software raster");
+        m_renderer.render();
+    }
+
+    void beginMode3D(const Camera &camera) override {
+        m_renderer.setCamera(camera);
+    }
+
+    void drawMesh(RayLibMesh &mesh, const Matrix &transform) override {
+        NullBackend::drawMesh(mesh, transform);
+        m_renderer.drawMesh(mesh.cpuMesh(), MatrixMultiply(transform, currentMatrix()));
+    }
+
+private:
+    SoftwareRenderer m_renderer;
+};
@@ -5,7 +5,11 @@
 //  Created by Antonio Malara on 22/01/2022.
 //
 
+#include "ImageCache.h"
+#include "MemoryReport.h"
+#include "RawBuffer.h"
 #include "Scene.h"
+#include "Trace.h"
 
 namespace TD {
 
@@ -122,23 +126,53 @@ void CarLst::load(FILE * file) {
 }
 
 struct Car {
-    std::vector<std::byte> sicbin;
-    std::vector<std::byte> sic;
+    std::string name;
+
+    RawBuffer sicbin;
+    RawBuffer sic;
    
-    std::vector<std::byte> col;
-    std::vector<std::byte> top;
-    std::vector<std::byte> bot1;
-    std::vector<std::byte> bot2;
-    std::vector<std::byte> lbot;
-    std::vector<std::byte> rbot;
-    std::vector<std::byte> etc;
-    
-    std::vector<std::byte> sc;
-    std::vector<std::byte> fl1;
-    std::vector<std::byte> fl2;
-    std::vector<std::byte> bic;
-    std::vector<std::byte> sid;
-    std::vector<std::byte> icn;
+    RawBuffer col;
+    RawBuffer top;
+    RawBuffer bot1;
+    RawBuffer bot2;
+    RawBuffer lbot;
+    RawBuffer rbot;
+    RawBuffer etc;
+    
+    RawBuffer sc;
+    RawBuffer fl1;
+    RawBuffer fl2;
+    RawBuffer bic;
+    RawBuffer sid;
+    RawBuffer icn;
+
+    template <typename Visit>
+    void forEachFile(Visit visit) const {
+        const std::pair<const char *, const RawBuffer *> files[] = {
+            { "SIC.BIN", &sicbin }, { ".SIC", &sic },
+            { "COL.BIN", &col },    { ".TOP", &top },
+            { "1.BOT", &bot1 },     { "2.BOT", &bot2 },
+            { "L.BOT", &lbot },     { "R.BOT", &rbot },
+            { ".ETC", &etc },       { "SC.BIN", &sc },
+            { "FL1.LZ", &fl1 },     { "FL2.LZ", &fl2 },
+            { ".BIC", &bic },       { ".SID", &sid },
+            { ".ICN", &icn },
+        };
+
+        for (auto &file : files)
+            visit(file.first, *file.second);
+    }
+
+    // Everything is decoded into CarImages
+    void decoded() const {
+        forEachFile([](const char *, const RawBuffer &file) {
+            file.decoded();
+        });
+    }
+
+    // By the suffix forEachFile() gives it, like ".TOP"
+    const RawBuffer &file(const std::string &suffix) const;
+    AssetId asset(const std::string &suffix) const;
 };
 
 class SceneLst {
@@ -167,36 +201,110 @@ void SceneLst::load(FILE *file) {
     }
 }
 
+// One file in an archive; whole files like the .pob models have no hashes
+struct PackedEntry {
+    std::string archive;
+    uint16_t hash1;
+    uint16_t hash2;
+    uint64_t contentHash;
+};
+
 class Resources {
 public:
-    Resources(std::string basePath);
+    Resources(std::string basePath, RawPolicy rawPolicy = RawPolicy::DropAfterDecode);
 
     const std::vector<std::byte> file(const std::string &name) const;
-    const std::vector<std::byte> fileForCar(const std::string &name, const std::string &lowerCarName, const CarLst &carLst);
-    const std::vector<std::byte> fileForScene(const std::string &name, const std::string &lowerCarName, const SceneLst &sceneLst);
+
+    // Read when first asked for, see RawBuffer
+    RawBuffer fileForCar(const std::string &name, const std::string &lowerCarName, const CarLst &carLst) const;
+    RawBuffer fileForScene(const std::string &name, const std::string &lowerCarName, const SceneLst &sceneLst,
+                           std::optional<RawPolicy> policy = {}) const;
 
     const std::vector<Car>& cars() { return carsArray; }
+
+    // Tracks are only read when asked for. Only touches the files of the
+    // track, so it can run on a background thread.
+    const std::vector<std::string> &trackNames() const { return m_trackNames; }
+    Scene loadScene(const std::string &sceneName,
+                    MemoryResource *memory = MemoryResource::heap()) const;
+
+    RawPolicy rawPolicy() const { return m_rawPolicy; }
+
+    // Decoded once for everyone, see ImageCache. Files of the shared
+    // archives by name, like "SELECT.LZ", or of a car by suffix.
+    ImageCache &imageCache() const { return m_imageCache; }
+    AssetId asset(const std::string &name) const;
+
+    std::shared_ptr<const GamePalette> palette(const std::string &name, int at) const;
+    std::shared_ptr<const GameImage> image(const std::string &name, int width,
+                                           const GamePalette &palette, int colorBase = 0) const;
+
+    std::shared_ptr<const GamePalette> palette(const Car &car, const std::string &suffix, int at) const;
+    std::shared_ptr<const GameImage> image(const Car &car, const std::string &suffix, int width,
+                                           const GamePalette &palette, int colorBase = 0) const;
+
+    // The car files and the models shared by every scene
+    void accountMemory(MemoryReport &report) const;
+
+    // For data edited while running, see HotReload.h. Each entry of every
+    // archive with a hash of its bytes, read afresh from disk.
+    const std::string &dataPath() const { return basePath; }
+    std::vector<PackedEntry> packedEntries() const;
+
+    // Main thread only, with nothing decoding from what they replace
+    void reloadFileTable();
+    void reloadCar(int index);
+    void reloadCarModel(int index);
+    void reloadGenericModels();
     
 private:
+    static std::vector<PackedFileDesc> ReadFileTable(const std::string &basePath);
+
+    CarLst loadCarLst(const std::string &carName) const;
+    SceneLst loadSceneLst(const std::string &sceneName) const;
+    Car loadCar(const std::string &carName) const;
+    Model loadCarModel(const std::string &carName) const;
+
     std::string basePath;
+    RawPolicy m_rawPolicy;
 
     PlayDisk playdisk;
     std::vector<PackedFileDesc> files;
+    mutable ImageCache m_imageCache;
     
 public:
     std::vector<Car> carsArray;
-    std::vector<Scene> m_scenes;
+    std::vector<std::string> m_trackNames;
     std::vector<Model> m_genericTiles;
     std::vector<Model> m_genericObjects;
     std::vector<Model> m_genericObjectsLod;
     std::vector<Model> m_carModels;
-    
-    std::vector<std::byte> m_scenetto;
 };
 
-Resources::Resources(const std::string basePath)
+Resources::Resources(const std::string basePath, RawPolicy rawPolicy)
     : basePath(basePath)
+    , m_rawPolicy(rawPolicy)
 {
+    files = ReadFileTable(basePath);
+
+    auto playdiskPath = basePath + "/" + "playdisk.dat";
+    auto playdiskFile = fopen(playdiskPath.c_str(), "r");
+    playdisk.load(playdiskFile);
+    fclose(playdiskFile);
+    
+    for (auto carName : playdisk.carNames()) {
+        carsArray.push_back(loadCar(carName));
+        m_carModels.push_back(loadCarModel(carName));
+    }
+    
+    m_trackNames = playdisk.trackNames();
+    
+    reloadGenericModels();
+}
+
+std::vector<PackedFileDesc> Resources::ReadFileTable(const std::string &basePath) {
+    std::vector<PackedFileDesc> files;
+
     auto exeFilePath = basePath + "/" + "td3.exe";
     auto exeFile = fopen(exeFilePath.c_str(), "r");
     fseek(exeFile, 0x20ae2, SEEK_SET);
@@ -214,87 +322,106 @@ Resources::Resources(const std::string basePath)
     }
     fclose(exeFile);
 
-    auto playdiskPath = basePath + "/" + "playdisk.dat";
-    auto playdiskFile = fopen(playdiskPath.c_str(), "r");
-    playdisk.load(playdiskFile);
-    fclose(playdiskFile);
-    
-    for (auto carName : playdisk.carNames()) {
-        auto path = basePath + "/" + carName + ".lst";
-        auto file = fopen(path.c_str(), "r");
+    return files;
+}
 
-        CarLst lst;
-        lst.load(file);
-        fclose(file);
+CarLst Resources::loadCarLst(const std::string &carName) const {
+    auto path = basePath + "/" + carName + ".lst";
+    auto file = fopen(path.c_str(), "r");
 
-        Car car;
-        car.col = fileForCar("COL.BIN", carName, lst);
-        
-        car.sicbin = fileForCar("SIC.BIN", carName, lst);
-        car.sic = fileForCar(".SIC", carName, lst);
-        
-        car.top = fileForCar(".TOP", carName, lst);
-        car.bot1 = fileForCar("1.BOT", carName, lst);
-        car.bot2 = fileForCar("2.BOT", carName, lst);
-        car.lbot = fileForCar("L.BOT", carName, lst);
-        car.rbot = fileForCar("R.BOT", carName, lst);
-        car.etc = fileForCar(".ETC", carName, lst);
-        
-        car.sc = fileForCar("SC.BIN", carName, lst);
-        car.fl1 = fileForCar("FL1.LZ", carName, lst);
-        car.fl2 = fileForCar("FL2.LZ", carName, lst);
-        car.bic = fileForCar(".BIC", carName, lst);
-        car.sid = fileForCar(".SID", carName, lst);
-        car.icn = fileForCar(".ICN", carName, lst);
-
-        carsArray.push_back(car);
-        
-        auto pobFilename = basePath + "/" + carName + ".pob";
-        auto pobFile = fopen(pobFilename.c_str(), "r");
-        fseek(pobFile, 0, SEEK_END);
+    CarLst lst;
+    lst.load(file);
+    fclose(file);
 
-        auto len = ftell(pobFile);
-        fseek(pobFile, 0, SEEK_SET);
-        
-        std::vector<std::byte> pobData(len);
-        fread(&pobData[0], len, 1, pobFile);
-        fclose(pobFile);
+    return lst;
+}
 
-        m_carModels.push_back(Model(pobData, 0, true));
-    }
+SceneLst Resources::loadSceneLst(const std::string &sceneName) const {
+    auto path = basePath + "/" + sceneName + ".lst";
+    auto file = fopen(path.c_str(), "r");
+
+    SceneLst lst;
+    lst.load(file);
+    fclose(file);
+
+    return lst;
+}
+
+Car Resources::loadCar(const std::string &carName) const {
+    auto lst = loadCarLst(carName);
+
+    Car car;
+    car.name = carName;
+    car.col = fileForCar("COL.BIN", carName, lst);
+    
+    car.sicbin = fileForCar("SIC.BIN", carName, lst);
+    car.sic = fileForCar(".SIC", carName, lst);
     
-    for (auto sceneName : playdisk.trackNames()) {
-        auto path = basePath + "/" + sceneName + ".lst";
-        auto file = fopen(path.c_str(), "r");
+    car.top = fileForCar(".TOP", carName, lst);
+    car.bot1 = fileForCar("1.BOT", carName, lst);
+    car.bot2 = fileForCar("2.BOT", carName, lst);
+    car.lbot = fileForCar("L.BOT", carName, lst);
+    car.rbot = fileForCar("R.BOT", carName, lst);
+    car.etc = fileForCar(".ETC", carName, lst);
+    
+    car.sc = fileForCar("SC.BIN", carName, lst);
+    car.fl1 = fileForCar("FL1.LZ", carName, lst);
+    car.fl2 = fileForCar("FL2.LZ", carName, lst);
+    car.bic = fileForCar(".BIC", carName, lst);
+    car.sid = fileForCar(".SID", carName, lst);
+    car.icn = fileForCar(".ICN", carName, lst);
+
+    return car;
+}
 
-        SceneLst lst;
-        lst.load(file);
-        fclose(file);
+Scene Resources::loadScene(const std::string &sceneName, MemoryResource *memory) const {
+    auto lst = loadSceneLst(sceneName);
 
-        Scene scene;
-        // a -> subcourse + 'A'
-        scene.a_dat = fileForScene("A.DAT", sceneName, lst);
-        scene.one_dat = fileForScene("1.DAT", sceneName, lst);
-        
-        scene.t_bin = fileForScene("T.BIN", sceneName, lst);
-        
-        //not used
-        scene.o_bin = fileForScene("O.BIN", sceneName, lst);
-        scene.p_bin = fileForScene("P.BIN", sceneName, lst);
-        
-        scene.tiles = LoadModels(scene.t_bin, 64);
-        
-        scene.loadObjectData(scene.a_dat);
+    Scene scene(memory);
+    // a -> subcourse + 'A', read for as long as the scene lives
+    scene.a_dat = fileForScene("A.DAT", sceneName, lst, RawPolicy::Keep);
+    scene.one_dat = fileForScene("1.DAT", sceneName, lst);
+    
+    scene.t_bin = fileForScene("T.BIN", sceneName, lst);
+    
+    //not used
+    scene.o_bin = fileForScene("O.BIN", sceneName, lst);
+    scene.p_bin = fileForScene("P.BIN", sceneName, lst);
 
-        m_scenes.push_back(scene);
-    }
+    if (scene.a_dat.get()->size() < Scene::ADatSize)
+        throw BadData(sceneName + " A.DAT is too short");
     
-    auto genericTilesFile = file("SCENETTT.BIN");
-    m_genericTiles = LoadModels(genericTilesFile, 64);
+    scene.tiles = LoadModels(*scene.t_bin.get(), 64, false, memory);
+    scene.t_bin.decoded();
     
-    m_scenetto = file("SCENETTO.BIN");
-    m_genericObjects = LoadModels(m_scenetto, 64);
-    m_genericObjectsLod = LoadModels(m_scenetto, 64, true);
+    scene.decodeTileGrid();
+    scene.loadObjectData(*scene.a_dat.get());
+
+    return scene;
+}
+
+void Resources::accountMemory(MemoryReport &report) const {
+    for (auto &car : carsArray) {
+        car.forEachFile([&](const char *name, const RawBuffer &file) {
+            report.add("cars", car.name + name, MemoryReport::Kind::Raw, file.bytes());
+        });
+    }
+
+    const std::pair<const char *, const std::vector<Model> *> models[] = {
+        { "generic tiles",       &m_genericTiles },
+        { "generic objects",     &m_genericObjects },
+        { "generic objects lod", &m_genericObjectsLod },
+        { "car models",          &m_carModels },
+    };
+
+    for (auto &list : models) {
+        long long bytes = 0;
+
+        for (auto &model : *list.second)
+            bytes += model.byteSize();
+
+        report.add("models", list.first, MemoryReport::Kind::Decoded, bytes);
+    }
 }
 
 uint16_t Hash2(const std::string &name) {
@@ -330,33 +457,142 @@ std::optional<PackedFileDesc> FindFileDesc(const std::string &name, const std::v
     return {};
 }
 
-const std::vector<std::byte> Resources::file(const std::string &name) const {
-    const std::map<char, std::string> char_to_files = {
+std::vector<std::byte> ReadPackedFile(const std::string &path, const PackedFileDesc &desc) {
+    std::vector<std::byte> ret(desc.size);
+
+    if (ret.empty())
+        return {};
+
+    auto file = fopen(path.c_str(), "r");
+
+    if (!file)
+        return {};
+
+    fseek(file, desc.start, SEEK_SET);
+    auto read = fread(&ret[0], 1, desc.size, file);
+    fclose(file);
+
+    // half written by whoever is editing it
+    if (read != desc.size)
+        return {};
+
+    return ret;
+}
+
+std::vector<std::byte> ReadWholeFile(const std::string &path) {
+    auto file = fopen(path.c_str(), "r");
+
+    if (!file)
+        return {};
+
+    fseek(file, 0, SEEK_END);
+
+    auto len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (len < 0) {
+        fclose(file);
+        return {};
+    }
+
+    std::vector<std::byte> data(len);
+    auto read = len > 0 ? fread(&data[0], 1, len, file) : 0;
+
+    fclose(file);
+
+    if (read != (size_t)len)
+        return {};
+
+    return data;
+}
+
+// FNV-1a
+uint64_t ContentHash(const std::vector<std::byte> &data) {
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    for (auto b : data) {
+        h ^= (uint8_t)b;
+        h *= 0x100000001b3ull;
+    }
+
+    return h;
+}
+
+const std::map<char, std::string> &PackedArchives() {
+    static const std::map<char, std::string> archives = {
         {'a', "dataa.dat"},
         {'b', "datab.dat"},
         {'c', "datac.dat"},
     };
-    
+
+    return archives;
+}
+
+const std::vector<std::byte> Resources::file(const std::string &name) const {
     if (const auto desc = FindFileDesc(name, files)) {
-        std::vector<std::byte> ret(desc->size);
-        
-        auto fileName = char_to_files.at(desc->dataFile);
+        auto fileName = PackedArchives().at(desc->dataFile);
         auto path = basePath + "/" + fileName;
         
-//        printf("%s %s %c %x %x\n", (name).c_str(), path.c_str(), desc->dataFile,desc->start, desc->size);
+        TD_TRACE(Resources, TraceValues, "file %04x:%04x %x %x\n", desc->hash1, desc->hash2, desc->start, desc->size);
 
-        auto file = fopen(path.c_str(), "r");
-        fseek(file, desc->start, SEEK_SET);
-        fread(&ret[0], 1, desc->size, file);
-        fclose(file);
-        
-        return ret;
+        return ReadPackedFile(path, *desc);
     }
 
     return {};
 }
 
-const std::vector<std::byte> Resources::fileForCar(const std::string &name, const std::string &lowerCarName, const CarLst &carLst) {
+AssetId Resources::asset(const std::string &name) const {
+    if (const auto desc = FindFileDesc(name, files))
+        return { PackedArchives().at(desc->dataFile), desc->hash1, desc->hash2 };
+
+    return { "", Hash1(name), Hash2(name) };
+}
+
+std::shared_ptr<const GamePalette> Resources::palette(const std::string &name, int at) const {
+    auto file = RawBuffer([this, name] { return this->file(name); });
+    return m_imageCache.palette(asset(name), file, at);
+}
+
+std::shared_ptr<const GameImage> Resources::image(const std::string &name, int width,
+                                                  const GamePalette &palette, int colorBase) const
+{
+    // only read on a miss
+    auto file = RawBuffer([this, name] { return this->file(name); });
+    return m_imageCache.image(asset(name), file, width, palette, colorBase);
+}
+
+std::shared_ptr<const GamePalette> Resources::palette(const Car &car, const std::string &suffix, int at) const {
+    return m_imageCache.palette(car.asset(suffix), car.file(suffix), at);
+}
+
+std::shared_ptr<const GameImage> Resources::image(const Car &car, const std::string &suffix, int width,
+                                                  const GamePalette &palette, int colorBase) const
+{
+    return m_imageCache.image(car.asset(suffix), car.file(suffix), width, palette, colorBase);
+}
+
+const RawBuffer &Car::file(const std::string &suffix) const {
+    static const RawBuffer none;
+    const RawBuffer *found = &none;
+
+    forEachFile([&](const char *name, const RawBuffer &file) {
+        if (suffix == name)
+            found = &file;
+    });
+
+    return *found;
+}
+
+AssetId Car::asset(const std::string &suffix) const {
+    std::string upperName;
+    for (auto c : name) {
+        upperName.push_back(toupper(c));
+    }
+
+    return { name + ".dat", Hash1(upperName + suffix), Hash2(upperName + suffix) };
+}
+
+RawBuffer Resources::fileForCar(const std::string &name, const std::string &lowerCarName, const CarLst &carLst) const {
     std::vector<PackedFileDesc> files;
     
     for (int i = 0; i < sizeof(carLst.files) / sizeof(PackedFileDesc); i++) {
@@ -369,22 +605,20 @@ const std::vector<std::byte> Resources::fileForCar(const std::string &name, cons
     }
     
     if (const auto desc = FindFileDesc(carNameUpper + name, files)) {
-        std::vector<std::byte> ret(desc->size);
-        
         auto path = basePath + "/" + lowerCarName + ".dat";
         
-        auto file = fopen(path.c_str(), "r");
-        fseek(file, desc->start, SEEK_SET);
-        fread(&ret[0], 1, desc->size, file);
-        fclose(file);
-        
-        return ret;
+        return RawBuffer([path, desc = *desc] {
+            return ReadPackedFile(path, desc);
+        }, m_rawPolicy);
     }
 
     return {};
 }
 
-const std::vector<std::byte> Resources::fileForScene(const std::string &name, const std::string &lowerSceneName, const SceneLst &sceneLst) {
+// The Resources' policy unless told otherwise
+RawBuffer Resources::fileForScene(const std::string &name, const std::string &lowerSceneName, const SceneLst &sceneLst,
+                                  std::optional<RawPolicy> policy) const
+{
     std::vector<PackedFileDesc> files;
     
     for (int i = 0; i < sizeof(sceneLst.files) / sizeof(PackedFileDesc); i++) {
@@ -397,22 +631,92 @@ const std::vector<std::byte> Resources::fileForScene(const std::string &name, co
     }
     
     if (const auto desc = FindFileDesc(upperSceneName + name, files)) {
-        std::vector<std::byte> ret(desc->size);
-        
         auto path = basePath + "/" + lowerSceneName + ".dat";
         
-//       printf("%s %s %c %x %x\n", (upperSceneName + name).c_str(), path.c_str(), desc->dataFile,desc->start, desc->size);
-        
-        auto file = fopen(path.c_str(), "r");
-        fseek(file, desc->start, SEEK_SET);
-        fread(&ret[0], 1, desc->size, file);
-        fclose(file);
-        
-        return ret;
+        return RawBuffer([path, desc = *desc] {
+            TD_TRACE(Resources, TraceValues, "scene file %04x:%04x %x %x\n", desc.hash1, desc.hash2, desc.start, desc.size);
+            return ReadPackedFile(path, desc);
+        }, policy.value_or(m_rawPolicy));
     }
     
     return {};
 }
 
+Model Resources::loadCarModel(const std::string &carName) const {
+    return Model(ReadWholeFile(basePath + "/" + carName + ".pob"), 0, true);
+}
+
+std::vector<PackedEntry> Resources::packedEntries() const {
+    std::vector<PackedEntry> entries;
+
+    auto add = [&](const std::string &archive, const PackedFileDesc &desc) {
+        if (!desc.hash1)
+            return;
+
+        auto data = ReadPackedFile(basePath + "/" + archive, desc);
+        entries.push_back({ archive, desc.hash1, desc.hash2, ContentHash(data) });
+    };
+
+    for (auto &desc : ReadFileTable(basePath)) {
+        auto archive = PackedArchives().find(desc.dataFile);
+
+        if (archive != PackedArchives().end())
+            add(archive->second, desc);
+    }
+
+    for (auto &car : carsArray) {
+        auto lst = loadCarLst(car.name);
+
+        for (auto &desc : lst.files)
+            add(car.name + ".dat", desc);
+
+        auto pob = car.name + ".pob";
+        entries.push_back({ pob, 0, 0, ContentHash(ReadWholeFile(basePath + "/" + pob)) });
+    }
+
+    for (auto &sceneName : m_trackNames) {
+        auto lst = loadSceneLst(sceneName);
+
+        // only as many as SceneLst::load reads
+        for (int i = 0; i < 15; i++)
+            add(sceneName + ".dat", lst.files[i]);
+    }
+
+    return entries;
+}
+
+void Resources::reloadFileTable() {
+    files = ReadFileTable(basePath);
+}
+
+void Resources::reloadCar(int index) {
+    carsArray.at(index) = loadCar(carsArray.at(index).name);
+}
+
+void Resources::reloadCarModel(int index) {
+    m_carModels.at(index) = loadCarModel(carsArray.at(index).name);
+}
+
+void Resources::reloadGenericModels() {
+    // all of them or none, if the data is bad
+    auto genericTilesFile = file("SCENETTT.BIN");
+    auto genericTiles = LoadModels(genericTilesFile, 64);
+    
+    auto genericObjectsFile = file("SCENETTO.BIN");
+    auto genericObjects = LoadModels(genericObjectsFile, 64);
+    auto genericObjectsLod = LoadModels(genericObjectsFile, 64, true);
+
+    // in place, the current scene's assets point at them until it reloads
+    auto replace = [](std::vector<Model> &models, std::vector<Model> &loaded) {
+        if (models.size() == loaded.size())
+            std::move(loaded.begin(), loaded.end(), models.begin());
+        else
+            models = std::move(loaded);
+    };
+
+    replace(m_genericTiles, genericTiles);
+    replace(m_genericObjects, genericObjects);
+    replace(m_genericObjectsLod, genericObjectsLod);
+}
 
 }
@@ -9,9 +9,19 @@
 
 #include "Models.h"
 #include "GameImage.h"
+#include "Culling.h"
+#include "MemoryReport.h"
+#include "MemoryResource.h"
+#include "RawBuffer.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
 
 namespace TD {
 
+class ColorTable;
+
 struct TileInfo {
 
     int tileId() const {
@@ -58,31 +68,169 @@ private:
     uint16_t m_rotation;
 };
 
+// The tile map decoded once, one array per field. Positions are in GL
+// world units with the tile at (x, y) centred on (x, height, y); the
+// transform is what DrawModelEx would build from position and angle.
+
+struct TileGrid {
+    static const int XTileCount = 32;
+    static const int YTileCount = 16;
+    static const int Count = XTileCount * YTileCount;
+
+    static int index(int tileX, int tileY) {
+        return tileY * XTileCount + tileX;
+    }
+
+    std::array<uint8_t, Count> tileId;
+    std::array<uint8_t, Count> rotation;
+    std::array<float,   Count> height;
+    std::array<Vector3, Count> position;
+    std::array<float,   Count> angle;
+    std::array<Matrix,  Count> transform;
+};
+
+inline Vector3 NormalizeTDWorldLocation(Point tdPos) {
+    return Vector3 {
+        .x = (tdPos.x * 4) / 4096.f - .5f,
+        .y = (tdPos.z / 8) / 4096.f,
+        .z = ((4096 * 16) - (tdPos.y * 4)) / 4096.f -.5f
+    };
+}
+
+// An object slot with its world placement worked out.
+
+struct PlacedObject {
+    int slot;           // index in Scene::m_objects
+    uint16_t modelId;
+    uint16_t flags;
+    bool isLOD;
+
+    Vector3 position;
+    float angle;
+    Matrix transform;
+};
+
+// The used object slots, in the order the game keeps them: active objects
+// first, then the remaining LOD ones, then the normal ones. Each category
+// is sorted by model so objects sharing a mesh are next to each other.
+
+class ObjectTable {
+public:
+    enum Category {
+        Active,
+        Lod,
+        Normal,
+        CategoryCount,
+    };
+
+    struct Range {
+        const PlacedObject *first;
+        const PlacedObject *last;
+
+        const PlacedObject *begin() const { return first; }
+        const PlacedObject *end()   const { return last; }
+        int size() const { return (int)(last - first); }
+    };
+
+    ObjectTable() = default;
+
+    ObjectTable(const ResourceVector<GameObject> &slots, int activeCount, int lodCount) {
+        int bounds[CategoryCount + 1] = { 0, activeCount, lodCount, (int)slots.size() };
+
+        for (int category = 0; category < CategoryCount; category++) {
+            m_start[category] = (int)m_objects.size();
+
+            for (int slot = bounds[category]; slot < bounds[category + 1]; slot++) {
+                auto &object = slots[slot];
+
+                if (object.modelId() == 0)
+                    continue;
+
+                PlacedObject placed;
+                placed.slot     = slot;
+                placed.modelId  = object.modelId();
+                placed.flags    = object.flags();
+                placed.isLOD    = object.isLOD();
+                placed.position = NormalizeTDWorldLocation(object.location());
+                placed.angle    = -object.rotation() * 90;
+                placed.transform = PlacementTransform(placed.position, placed.angle);
+
+                m_objects.push_back(placed);
+            }
+
+            std::stable_sort(m_objects.begin() + m_start[category], m_objects.end(), [](auto &a, auto &b) {
+                return a.modelId != b.modelId ? a.modelId < b.modelId : a.isLOD < b.isLOD;
+            });
+        }
+
+        m_start[CategoryCount] = (int)m_objects.size();
+    }
+
+    const std::vector<PlacedObject> &all() const {
+        return m_objects;
+    }
+
+    Range category(Category category) const {
+        return {
+            m_objects.data() + m_start[category],
+            m_objects.data() + m_start[category + 1],
+        };
+    }
+
+    int size() const {
+        return (int)m_objects.size();
+    }
+
+    const PlacedObject &operator[](int i) const {
+        return m_objects[i];
+    }
+
+private:
+    std::vector<PlacedObject> m_objects;
+    int m_start[CategoryCount + 1] = { 0 };
+};
+
 class Scene {
 
 private:
     static const int tta_dseg_start_offset = 0x9370;
 
 public:
-    static const int XTileCount = 32;
-    static const int YTileCount = 16;
+    static const int XTileCount = TileGrid::XTileCount;
+    static const int YTileCount = TileGrid::YTileCount;
+
+    // Up to the end of the last table read from it, mapColor's single colours
+    static const int ADatSize = 0xb497 + 0x10 - tta_dseg_start_offset;
+
+    // What the scene decodes comes from memory; it has to outlive the
+    // scene, see Arena
+    explicit Scene(MemoryResource *memory = MemoryResource::heap())
+        : m_objects(memory)
+        , m_memory(memory)
+    { }
+
+    MemoryResource *memory() const {
+        return m_memory;
+    }
 
     int getSingleCourseDataBoh() const {
         static int offset = 0x939d - tta_dseg_start_offset;
-        return std::to_integer<uint8_t>(a_dat[offset]);
+        return std::to_integer<uint8_t>((*a_dat.get())[offset]);
     }
 
     uint8_t getCourseDataLut2(int i) const {
         static int offset = 0x93bf - tta_dseg_start_offset;
-        return GetByte(a_dat, offset + i);
+        return GetByte(*a_dat.get(), offset + i);
     }
 
     TileInfo getTileInfo(int l) const {
         static int offset = 0x944f - tta_dseg_start_offset;
+        auto file = a_dat.get();
+        auto &data = *file;
 
         return {
-            .tile = a_dat[offset + l * 2    ],
-            .info = a_dat[offset + l * 2 + 1],
+            .tile = data[offset + l * 2    ],
+            .info = data[offset + l * 2 + 1],
         };
     }
 
@@ -93,21 +241,23 @@ public:
     Color mapColor(uint8_t colorHi, uint8_t colorLo, const GamePalette &palette) const {
         static int doubleColorTable = 0xb297 - tta_dseg_start_offset;
         static int singleColorTable = 0xb497 - tta_dseg_start_offset;
+        auto file = a_dat.get();
+        auto &data = *file;
 
         if (colorHi & 0x10) {
-            colorHi = std::to_integer<uint8_t>(a_dat[singleColorTable + (colorHi & 0x0f)]);
+            colorHi = std::to_integer<uint8_t>(data[singleColorTable + (colorHi & 0x0f)]);
             if (colorLo & 0x10) {
-                colorLo = std::to_integer<uint8_t>(a_dat[singleColorTable + (colorLo & 0x0f)]);
+                colorLo = std::to_integer<uint8_t>(data[singleColorTable + (colorLo & 0x0f)]);
             }
         }
         else if (colorLo & 0x10) {
-            colorLo = std::to_integer<uint8_t>(a_dat[singleColorTable + (colorLo & 0x0f)]);
+            colorLo = std::to_integer<uint8_t>(data[singleColorTable + (colorLo & 0x0f)]);
         }
         else {
             auto idx = (colorHi << 4) | colorLo;
 
-            colorLo = std::to_integer<uint8_t>(a_dat[doubleColorTable + (idx * 2) + 0]);
-            colorHi = std::to_integer<uint8_t>(a_dat[doubleColorTable + (idx * 2) + 1]);
+            colorLo = std::to_integer<uint8_t>(data[doubleColorTable + (idx * 2) + 0]);
+            colorHi = std::to_integer<uint8_t>(data[doubleColorTable + (idx * 2) + 1]);
         }
 
         auto pattern0rgb = palette.get(colorLo);
@@ -121,6 +271,31 @@ public:
         return color;
     }
 
+    // mapColor for every (colorHi, colorLo) pair, cached per palette and
+    // rebuilt (invalidating the previous reference) when the palette
+    // changes. Not thread safe: fetch it before handing it to workers.
+    const ColorTable &colorTable(const GamePalette &palette) const;
+
+    void decodeTileGrid() {
+        for (int y = 0; y < YTileCount; y++) {
+            for (int x = 0; x < XTileCount; x++) {
+                auto i = TileGrid::index(x, y);
+                auto info = getTileInfo(i);
+
+                m_tileGrid.tileId[i]    = info.tileId();
+                m_tileGrid.rotation[i]  = info.rot();
+                m_tileGrid.height[i]    = info.height() / 4096.f;
+                m_tileGrid.position[i]  = { (float)x, m_tileGrid.height[i], (float)y };
+                m_tileGrid.angle[i]     = -info.rot() * 90;
+                m_tileGrid.transform[i] = PlacementTransform(m_tileGrid.position[i], m_tileGrid.angle[i]);
+            }
+        }
+    }
+
+    const TileGrid &tileGrid() const {
+        return m_tileGrid;
+    }
+
     void loadObjectData(const std::vector<std::byte> &a_dat)
     {
         const auto objectIdOffset    = 0xa257 - tta_dseg_start_offset;
@@ -129,13 +304,16 @@ public:
         const auto zOffset           = 0xa617 - tta_dseg_start_offset;
         const auto orientationOffset = 0xa757 - tta_dseg_start_offset;
 
-        /*
-        auto normalObjectsCount = GetWord(a_dat, 0xa251 - 0x9370);
-        auto activeObjectsCount = GetWord(a_dat, 0xa253 - 0x9370);
-        auto lodObjectsCount    = GetWord(a_dat, 0xa255 - 0x9370);
-        */
+        // the counts are cumulative: active objects come first, then LOD
+        // objects up to lodObjectsCount, then normal ones up to the total
+        auto normalObjectsCount = std::min<int>(GetWord(a_dat, 0xa251 - tta_dseg_start_offset), MaxObjects);
+        auto activeObjectsCount = std::min<int>(GetWord(a_dat, 0xa253 - tta_dseg_start_offset), normalObjectsCount);
+        auto lodObjectsCount    = std::clamp<int>(GetWord(a_dat, 0xa255 - tta_dseg_start_offset), activeObjectsCount, normalObjectsCount);
+
+        m_objects.clear();
+        m_objects.reserve(normalObjectsCount);
 
-        for (int i = 0; i < 0xa0; i++)
+        for (int i = 0; i < normalObjectsCount; i++)
         {
             m_objects.emplace_back(
                 GetWord(a_dat, objectIdOffset + i * 2),
@@ -145,18 +323,117 @@ public:
                 GetWord(a_dat, orientationOffset + i * 2)
             );
         }
+
+        m_objectTable = ObjectTable(m_objects, activeObjectsCount, lodObjectsCount);
     }
 
+    const ObjectTable &objectTable() const {
+        return m_objectTable;
+    }
+
+    // The tile grid, objects, models and course sprites made from the
+    // archive files exist. A.DAT stays, the accessors above and new colour
+    // tables read it.
+    void decoded() const {
+        for (auto file : { &one_dat, &t_bin, &o_bin, &p_bin })
+            file->decoded();
+    }
+
+    void accountMemory(MemoryReport &report, const std::string &subsystem) const;
+
 public:
-    std::vector<std::byte> a_dat;
-    std::vector<std::byte> one_dat;
-    std::vector<std::byte> t_bin;
-    std::vector<std::byte> o_bin;
-    std::vector<std::byte> p_bin;
+    RawBuffer a_dat;
+    RawBuffer one_dat;
+    RawBuffer t_bin;
+    RawBuffer o_bin;      // not used
+    RawBuffer p_bin;      // not used
 
     std::vector<Model> tiles;
 
-    std::vector<GameObject> m_objects;
+    ResourceVector<GameObject> m_objects;
+
+private:
+    static constexpr int MaxObjects = 0xa0;
+
+    MemoryResource *m_memory;
+
+    TileGrid m_tileGrid;
+    ObjectTable m_objectTable;
+    mutable std::vector<std::shared_ptr<const ColorTable>> m_colorTables;
 };
 
+// Poly colours are two 5-bit fields, so every colour a scene can produce
+// with a given palette fits in 1024 entries.
+
+class ColorTable {
+public:
+    ColorTable(const Scene &scene, const GamePalette &palette)
+        : m_paletteId(palette.id())
+        , m_paletteVersion(palette.version())
+    {
+        for (int hi = 0; hi < 0x20; hi++) {
+            for (int lo = 0; lo < 0x20; lo++) {
+                m_colors[index(hi, lo)] = scene.mapColor(hi, lo, palette);
+            }
+        }
+    }
+
+    Color get(uint8_t colorHi, uint8_t colorLo) const {
+        return m_colors[index(colorHi, colorLo)];
+    }
+
+    bool isValidFor(const GamePalette &palette) const {
+        return m_paletteId == palette.id() && m_paletteVersion == palette.version();
+    }
+
+    int paletteId() const {
+        return m_paletteId;
+    }
+
+private:
+    static int index(uint8_t colorHi, uint8_t colorLo) {
+        return ((colorHi & 0x1f) << 5) | (colorLo & 0x1f);
+    }
+
+    std::array<Color, 0x400> m_colors;
+    int m_paletteId;
+    int m_paletteVersion;
+};
+
+inline const ColorTable &Scene::colorTable(const GamePalette &palette) const {
+    for (auto &table : m_colorTables) {
+        if (table->paletteId() != palette.id())
+            continue;
+
+        if (!table->isValidFor(palette))
+            table = std::make_shared<const ColorTable>(*this, palette);
+
+        return *table;
+    }
+
+    m_colorTables.push_back(std::make_shared<const ColorTable>(*this, palette));
+    return *m_colorTables.back();
+}
+
+inline void Scene::accountMemory(MemoryReport &report, const std::string &subsystem) const {
+    const std::pair<const char *, const RawBuffer *> files[] = {
+        { "A.DAT", &a_dat }, { "1.DAT", &one_dat }, { "T.BIN", &t_bin },
+        { "O.BIN", &o_bin }, { "P.BIN", &p_bin },
+    };
+
+    for (auto &file : files)
+        report.add(subsystem, file.first, MemoryReport::Kind::Raw, file.second->bytes());
+
+    long long tileBytes = 0;
+
+    for (auto &model : tiles)
+        tileBytes += model.byteSize();
+
+    report.add(subsystem, "tile models", MemoryReport::Kind::Decoded, tileBytes);
+    report.add(subsystem, "objects", MemoryReport::Kind::Decoded,
+               m_objects.size() * sizeof(GameObject) + m_objectTable.size() * sizeof(PlacedObject));
+    report.add(subsystem, "tile grid", MemoryReport::Kind::Decoded, sizeof(TileGrid));
+    report.add(subsystem, "color tables", MemoryReport::Kind::Decoded, m_colorTables.size() * sizeof(ColorTable));
+}
+
 }
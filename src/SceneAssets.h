@@ -8,73 +8,105 @@
 #pragma once
 
 #import "Resources.h"
-#import "RaylibMesh.h"
+#import "MeshRegistry.h"
+#import "CourseSprites.h"
 
 struct SceneAssets {
     SceneAssets(TD::Resources& res,
                 TD::GamePalette& otwPalette,
                 TD::Scene& scene)
+        : registry(otwPalette, scene)
+        , courseSprites(scene, otwPalette)
     {
+        registry.prebuild(allModels(res, scene));
+
         for (auto &tileTdModel : res.m_genericTiles) {
-            genericTiles.emplace_back(RayLibMesh(tileTdModel, otwPalette, scene));
+            genericTiles.push_back(registry.get(tileTdModel));
 
-            tileExplorerMeshes.emplace_back(RayLibMesh(tileTdModel, otwPalette, scene));
-            tileExplorerModels.emplace_back(TD::Model(tileTdModel));
+            tileExplorerMeshes.push_back(genericTiles.back());
+            tileExplorerModels.push_back(&tileTdModel);
         }
 
         for (auto &tileTdModel : scene.tiles) {
-            tileMeshes.emplace_back(RayLibMesh(tileTdModel, otwPalette, scene));
+            tileMeshes.push_back(registry.get(tileTdModel));
 
-            tileExplorerMeshes.emplace_back(RayLibMesh(tileTdModel, otwPalette, scene));
-            tileExplorerModels.emplace_back(TD::Model(tileTdModel));
+            tileExplorerMeshes.push_back(tileMeshes.back());
+            tileExplorerModels.push_back(&tileTdModel);
         }
 
         for (auto &i : res.m_genericObjects) {
-            objectMeshes.emplace_back(RayLibMesh(i, otwPalette, scene));
+            objectMeshes.push_back(registry.get(i));
 
-            modelExplorerMeshes.emplace_back(RayLibMesh(i, otwPalette, scene));
-            modelExplorerModels.emplace_back(TD::Model(i));
+            modelExplorerMeshes.push_back(objectMeshes.back());
+            modelExplorerModels.push_back(&i);
         }
 
         for (auto &i : res.m_genericObjectsLod)
-            objectLodMeshes.emplace_back(RayLibMesh(i, otwPalette, scene));
+            objectLodMeshes.push_back(registry.get(i));
 
         for (auto &i : res.m_carModels) {
-            carMeshes.emplace_back(RayLibMesh(i, otwPalette, scene));
+            carMeshes.push_back(registry.get(i));
         }
     }
 
+    void accountMemory(MemoryReport &report, const std::string &subsystem) const {
+        registry.accountMemory(report, subsystem);
+        courseSprites.accountMemory(report, subsystem);
+    }
+
+    static std::vector<const TD::Model *> allModels(TD::Resources& res, TD::Scene& scene) {
+        std::vector<const TD::Model *> models;
+
+        for (auto list : { &res.m_genericTiles, &scene.tiles,
+                           &res.m_genericObjects, &res.m_genericObjectsLod,
+                           &res.m_carModels })
+        {
+            for (auto &model : *list)
+                models.push_back(&model);
+        }
+
+        return models;
+    }
+
+    // Generic tiles come first, there are 0x40 of them
+    const TD::Model &tileModel(int tileId) const {
+        return *tileExplorerModels[tileId];
+    }
+
     RayLibMesh* meshForModelId(int modelId, bool isLOD) {
         if (modelId == 0) {
             return nullptr;
         }
         else if (modelId == 1) {
-            return &(carMeshes[0]);
+            return carMeshes[0].get();
         }
         else if (modelId == 2) {
-            return &(carMeshes[2]);
+            return carMeshes[2].get();
         }
         else if (modelId == 3) {
-            return &(carMeshes[1]);
+            return carMeshes[1].get();
         }
         else if (isLOD){
-            return &(objectLodMeshes[modelId]);
+            return objectLodMeshes[modelId].get();
         }
         else {
-            return &(objectMeshes[modelId]);
+            return objectMeshes[modelId].get();
         }
     }
 
-    std::vector<RayLibMesh> genericTiles;
-    std::vector<RayLibMesh> tileMeshes;
-    std::vector<RayLibMesh> objectMeshes;
-    std::vector<RayLibMesh> objectLodMeshes;
-    std::vector<RayLibMesh> carMeshes;
+    MeshRegistry registry;
+    CourseSprites courseSprites;
+
+    std::vector<MeshHandle> genericTiles;
+    std::vector<MeshHandle> tileMeshes;
+    std::vector<MeshHandle> objectMeshes;
+    std::vector<MeshHandle> objectLodMeshes;
+    std::vector<MeshHandle> carMeshes;
 
-    std::vector<TD::Model>  tileExplorerModels;
-    std::vector<RayLibMesh> tileExplorerMeshes;
+    std::vector<const TD::Model *> tileExplorerModels;
+    std::vector<MeshHandle>        tileExplorerMeshes;
 
-    std::vector<TD::Model>  modelExplorerModels;
-    std::vector<RayLibMesh> modelExplorerMeshes;
+    std::vector<const TD::Model *> modelExplorerModels;
+    std::vector<MeshHandle>        modelExplorerMeshes;
 };
 
@@ -0,0 +1,413 @@
+//
+//  SceneBvh.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <optional>
+#include <vector>
+
+#include "Culling.h"
+#include "MeshBuilder.h"
+
+// Bounding volume hierarchy over the world space triangles of a scene: the
+// tiles and every placed object. Built once when the scene is ready, then
+// only queried.
+
+struct SceneHit {
+    float distance;
+    Vector3 point;
+    Vector3 normal;
+    int object;         // as passed to addMesh(), -1 for the terrain
+};
+
+class SceneBvh {
+public:
+    static const int NoObject = -1;
+
+    void addMesh(const CpuMesh &mesh, const Matrix &transform, int object = NoObject) {
+        auto bounds = EmptyBoundingBox();
+
+        for (int i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            Triangle t;
+            t.a = vertex(mesh, mesh.indices[i + 0], transform);
+            t.b = vertex(mesh, mesh.indices[i + 1], transform);
+            t.c = vertex(mesh, mesh.indices[i + 2], transform);
+            t.object = object;
+
+            ExpandBoundingBox(bounds, t.a);
+            ExpandBoundingBox(bounds, t.b);
+            ExpandBoundingBox(bounds, t.c);
+
+            m_triangles.push_back(t);
+        }
+
+        if (object == NoObject)
+            return;
+
+        if (object >= m_objectBounds.size())
+            m_objectBounds.resize(object + 1, EmptyBoundingBox());
+
+        ExpandBoundingBox(m_objectBounds[object], bounds);
+    }
+
+    void build() {
+        m_nodes.clear();
+        m_nodes.reserve(m_triangles.size() * 2 / LeafSize + 1);
+
+        m_centroids.resize(m_triangles.size());
+        for (int i = 0; i < m_triangles.size(); i++) {
+            auto &t = m_triangles[i];
+            m_centroids[i] = Vector3Scale(Vector3Add(Vector3Add(t.a, t.b), t.c), 1 / 3.f);
+        }
+
+        m_nodes.push_back({});
+        split(0, 0, (int)m_triangles.size());
+
+        m_centroids.clear();
+        m_centroids.shrink_to_fit();
+    }
+
+    int triangleCount() const { return (int)m_triangles.size(); }
+    int nodeCount()     const { return (int)m_nodes.size(); }
+
+    const BoundingBox &objectBounds(int object) const {
+        static const auto empty = EmptyBoundingBox();
+
+        return object >= 0 && object < m_objectBounds.size()
+            ? m_objectBounds[object]
+            : empty;
+    }
+
+    // Closest hit along the ray, both faces count
+    std::optional<SceneHit> raycast(Ray ray, float maxDistance = FLT_MAX, bool terrainOnly = false) const {
+        if (m_nodes.empty())
+            return std::nullopt;
+
+        auto invDirection = Vector3 {
+            1 / ray.direction.x,
+            1 / ray.direction.y,
+            1 / ray.direction.z,
+        };
+
+        const Triangle *closest = nullptr;
+        auto closestDistance = maxDistance;
+
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            auto &node = m_nodes[stack[--top]];
+
+            if (rayBoxDistance(ray.position, invDirection, node.bounds) >= closestDistance)
+                continue;
+
+            if (node.count > 0) {
+                for (int i = node.first; i < node.first + node.count; i++) {
+                    auto &t = m_triangles[i];
+
+                    if (terrainOnly && t.object != NoObject)
+                        continue;
+
+                    auto distance = rayTriangleDistance(ray, t);
+
+                    if (distance < closestDistance) {
+                        closestDistance = distance;
+                        closest = &t;
+                    }
+                }
+
+                continue;
+            }
+
+            // nearer child on top so it is visited first
+            auto left  = node.first;
+            auto right = node.first + 1;
+
+            auto leftDistance  = rayBoxDistance(ray.position, invDirection, m_nodes[left].bounds);
+            auto rightDistance = rayBoxDistance(ray.position, invDirection, m_nodes[right].bounds);
+
+            if (leftDistance < rightDistance)
+                std::swap(left, right);
+
+            stack[top++] = left;
+            stack[top++] = right;
+        }
+
+        if (!closest)
+            return std::nullopt;
+
+        auto normal = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(closest->b, closest->a),
+                                                           Vector3Subtract(closest->c, closest->a)));
+
+        if (Vector3DotProduct(normal, ray.direction) > 0)
+            normal = Vector3Negate(normal);
+
+        return SceneHit {
+            .distance = closestDistance,
+            .point = Vector3Add(ray.position, Vector3Scale(ray.direction, closestDistance)),
+            .normal = normal,
+            .object = closest->object,
+        };
+    }
+
+    // Height of the terrain below (x, z), ignoring objects
+    std::optional<float> groundHeight(float x, float z) const {
+        if (m_nodes.empty())
+            return std::nullopt;
+
+        auto top = m_nodes[0].bounds.max.y + 1;
+        auto ray = Ray { { x, top, z }, { 0, -1, 0 } };
+
+        if (auto hit = raycast(ray, FLT_MAX, true))
+            return hit->point.y;
+
+        return std::nullopt;
+    }
+
+    // Object with the triangle closest to point, within maxDistance
+    int nearestObject(Vector3 point, float maxDistance = FLT_MAX) const {
+        auto closest = NoObject;
+        auto closestSquared = maxDistance == FLT_MAX ? FLT_MAX : maxDistance * maxDistance;
+
+        if (m_nodes.empty())
+            return closest;
+
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            auto &node = m_nodes[stack[--top]];
+
+            if (pointBoxDistanceSquared(point, node.bounds) >= closestSquared)
+                continue;
+
+            if (node.count > 0) {
+                for (int i = node.first; i < node.first + node.count; i++) {
+                    auto &t = m_triangles[i];
+
+                    if (t.object == NoObject)
+                        continue;
+
+                    auto d = Vector3Subtract(closestPointOnTriangle(point, t), point);
+                    auto squared = Vector3DotProduct(d, d);
+
+                    if (squared < closestSquared) {
+                        closestSquared = squared;
+                        closest = t.object;
+                    }
+                }
+
+                continue;
+            }
+
+            auto left  = node.first;
+            auto right = node.first + 1;
+
+            if (pointBoxDistanceSquared(point, m_nodes[left].bounds) <
+                pointBoxDistanceSquared(point, m_nodes[right].bounds))
+            {
+                std::swap(left, right);
+            }
+
+            stack[top++] = left;
+            stack[top++] = right;
+        }
+
+        return closest;
+    }
+
+private:
+    static const int LeafSize = 4;
+
+    struct Triangle {
+        Vector3 a, b, c;
+        int object;
+    };
+
+    // Leaves have count > 0 and own triangles [first, first + count);
+    // inner nodes have their two children at first and first + 1.
+    struct Node {
+        BoundingBox bounds;
+        int first;
+        int count;
+    };
+
+    static Vector3 vertex(const CpuMesh &mesh, int index, const Matrix &transform) {
+        auto v = &mesh.vertices[index * 3];
+        return Vector3Transform({ v[0], v[1], v[2] }, transform);
+    }
+
+    // Median split along the longest axis of the centroids. The tree is
+    // at most ~log2(triangles / LeafSize) deep, well within the stacks above.
+    void split(int nodeIndex, int first, int count) {
+        auto bounds = EmptyBoundingBox();
+        auto centroidBounds = EmptyBoundingBox();
+
+        for (int i = first; i < first + count; i++) {
+            ExpandBoundingBox(bounds, m_triangles[i].a);
+            ExpandBoundingBox(bounds, m_triangles[i].b);
+            ExpandBoundingBox(bounds, m_triangles[i].c);
+            ExpandBoundingBox(centroidBounds, m_centroids[i]);
+        }
+
+        m_nodes[nodeIndex].bounds = bounds;
+
+        if (count <= LeafSize) {
+            m_nodes[nodeIndex].first = first;
+            m_nodes[nodeIndex].count = count;
+            return;
+        }
+
+        auto extent = Vector3Subtract(centroidBounds.max, centroidBounds.min);
+        auto axis = extent.x > extent.y
+            ? (extent.x > extent.z ? 0 : 2)
+            : (extent.y > extent.z ? 1 : 2);
+
+        auto key = [axis](const Vector3 &v) {
+            return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+        };
+
+        // sort an index permutation, then apply it to both arrays
+        std::vector<int> order(count);
+        for (int i = 0; i < count; i++)
+            order[i] = first + i;
+
+        auto middle = count / 2;
+        std::nth_element(order.begin(), order.begin() + middle, order.end(), [&](int a, int b) {
+            return key(m_centroids[a]) < key(m_centroids[b]);
+        });
+
+        std::vector<Triangle> triangles(count);
+        std::vector<Vector3> centroids(count);
+
+        for (int i = 0; i < count; i++) {
+            triangles[i] = m_triangles[order[i]];
+            centroids[i] = m_centroids[order[i]];
+        }
+
+        std::copy(triangles.begin(), triangles.end(), m_triangles.begin() + first);
+        std::copy(centroids.begin(), centroids.end(), m_centroids.begin() + first);
+
+        auto children = (int)m_nodes.size();
+        m_nodes[nodeIndex].first = children;
+        m_nodes[nodeIndex].count = 0;
+
+        m_nodes.push_back({});
+        m_nodes.push_back({});
+
+        split(children,     first,          middle);
+        split(children + 1, first + middle, count - middle);
+    }
+
+    static float rayBoxDistance(Vector3 origin, Vector3 invDirection, const BoundingBox &box) {
+        auto tx1 = (box.min.x - origin.x) * invDirection.x;
+        auto tx2 = (box.max.x - origin.x) * invDirection.x;
+        auto ty1 = (box.min.y - origin.y) * invDirection.y;
+        auto ty2 = (box.max.y - origin.y) * invDirection.y;
+        auto tz1 = (box.min.z - origin.z) * invDirection.z;
+        auto tz2 = (box.max.z - origin.z) * invDirection.z;
+
+        auto tmin = fmaxf(fmaxf(fminf(tx1, tx2), fminf(ty1, ty2)), fminf(tz1, tz2));
+        auto tmax = fminf(fminf(fmaxf(tx1, tx2), fmaxf(ty1, ty2)), fmaxf(tz1, tz2));
+
+        if (tmax < 0 || tmin > tmax)
+            return FLT_MAX;
+
+        return fmaxf(tmin, 0);
+    }
+
+    // Möller-Trumbore
+    static float rayTriangleDistance(const Ray &ray, const Triangle &t) {
+        const float Epsilon = 1e-7f;
+
+        auto edge1 = Vector3Subtract(t.b, t.a);
+        auto edge2 = Vector3Subtract(t.c, t.a);
+        auto p = Vector3CrossProduct(ray.direction, edge2);
+        auto det = Vector3DotProduct(edge1, p);
+
+        if (fabsf(det) < Epsilon)
+            return FLT_MAX;
+
+        auto invDet = 1 / det;
+        auto s = Vector3Subtract(ray.position, t.a);
+        auto u = Vector3DotProduct(s, p) * invDet;
+
+        if (u < 0 || u > 1)
+            return FLT_MAX;
+
+        auto q = Vector3CrossProduct(s, edge1);
+        auto v = Vector3DotProduct(ray.direction, q) * invDet;
+
+        if (v < 0 || u + v > 1)
+            return FLT_MAX;
+
+        auto distance = Vector3DotProduct(edge2, q) * invDet;
+        return distance > Epsilon ? distance : FLT_MAX;
+    }
+
+    static float pointBoxDistanceSquared(Vector3 p, const BoundingBox &box) {
+        auto dx = fmaxf(fmaxf(box.min.x - p.x, 0), p.x - box.max.x);
+        auto dy = fmaxf(fmaxf(box.min.y - p.y, 0), p.y - box.max.y);
+        auto dz = fmaxf(fmaxf(box.min.z - p.z, 0), p.z - box.max.z);
+
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    // From Ericson, Real-Time Collision Detection, 5.1.5
+    static Vector3 closestPointOnTriangle(Vector3 p, const Triangle &t) {
+        auto ab = Vector3Subtract(t.b, t.a);
+        auto ac = Vector3Subtract(t.c, t.a);
+        auto ap = Vector3Subtract(p, t.a);
+
+        auto d1 = Vector3DotProduct(ab, ap);
+        auto d2 = Vector3DotProduct(ac, ap);
+        if (d1 <= 0 && d2 <= 0)
+            return t.a;
+
+        auto bp = Vector3Subtract(p, t.b);
+        auto d3 = Vector3DotProduct(ab, bp);
+        auto d4 = Vector3DotProduct(ac, bp);
+        if (d3 >= 0 && d4 <= d3)
+            return t.b;
+
+        auto vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0)
+            return Vector3Add(t.a, Vector3Scale(ab, d1 / (d1 - d3)));
+
+        auto cp = Vector3Subtract(p, t.c);
+        auto d5 = Vector3DotProduct(ab, cp);
+        auto d6 = Vector3DotProduct(ac, cp);
+        if (d6 >= 0 && d5 <= d6)
+            return t.c;
+
+        auto vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0)
+            return Vector3Add(t.a, Vector3Scale(ac, d2 / (d2 - d6)));
+
+        auto va = d3 * d6 - d5 * d4;
+        if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+            return Vector3Add(t.b, Vector3Scale(Vector3Subtract(t.c, t.b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+        auto denom = 1 / (va + vb + vc);
+        auto v = vb * denom;
+        auto w = vc * denom;
+
+        return Vector3Add(t.a, Vector3Add(Vector3Scale(ab, v), Vector3Scale(ac, w)));
+    }
+
+    std::vector<Triangle> m_triangles;
+    std::vector<Vector3> m_centroids;
+    std::vector<Node> m_nodes;
+    std::vector<BoundingBox> m_objectBounds;
+};
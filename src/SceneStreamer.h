@@ -0,0 +1,198 @@
+//
+//  SceneStreamer.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <string>
+
+#include "Arena.h"
+#include "SceneAssets.h"
+#include "ThreadPool.h"
+
+// Owns the scene being shown and swaps in another one at runtime. The new
+// scene's archive reads, model parsing and mesh building run on a
+// background thread while the current one keeps rendering; the upload and
+// the swap happen on the main thread in update().
+//
+// At most two scenes are alive at once: the current one and the one being
+// loaded. Requests made while a load is in flight only remember the name.
+// Once a scene's assets are built its archive files but A.DAT are let go,
+// as the Resources' RawPolicy says.
+//
+// Each scene decodes and builds into an Arena of its own, freed in one go
+// with the scene.
+
+class SceneStreamer {
+public:
+    // The first block of a scene's arena, about what the stock tracks use
+    static constexpr size_t SceneArenaBytes = 5 << 20;
+
+    SceneStreamer(TD::Resources &res, TD::GamePalette &palette)
+        : m_res(res)
+        , m_palette(palette)
+    { }
+
+    // Blocking, for the first scene
+    void loadNow(const std::string &name) {
+        m_current = load(name);
+        m_generation++;
+    }
+
+    // Blocking, between frames: for changes the current assets cannot
+    // outlive, like the shared models they point into. Not while loading.
+    // Bad data keeps the current scene.
+    void reloadNow() {
+        std::unique_ptr<Slot> loaded;
+
+        try {
+            loaded = load(sceneName());
+        }
+        catch (const TD::BadData &error) {
+            printf("[reload] %s rejected: %s\n", sceneName().c_str(), error.what());
+            return;
+        }
+
+        loaded->assets->registry.uploadAll();
+
+        m_current = std::move(loaded);
+        m_generation++;
+    }
+
+    void request(const std::string &name) {
+        if (m_pending.valid()) {
+            m_queued = name;
+            return;
+        }
+
+        // without threads the load runs in update(), on the main thread
+        auto policy = TD_THREADS_AVAILABLE ? std::launch::async : std::launch::deferred;
+
+        m_pendingName = name;
+        m_pending = std::async(policy, [this, name] {
+            return load(name);
+        });
+    }
+
+    void requestNext() {
+        auto &names = m_res.trackNames();
+
+        if (names.empty())
+            return;
+
+        auto current = std::find(names.begin(), names.end(), sceneName());
+        auto next = current == names.end() || current + 1 == names.end()
+            ? names.begin()
+            : current + 1;
+
+        request(*next);
+    }
+
+    // Main thread, with the window open. Returns true if the scene changed;
+    // a scene with bad data is not swapped in.
+    bool update() {
+        if (!m_pending.valid())
+            return false;
+
+        if (m_pending.wait_for(std::chrono::seconds(0)) == std::future_status::timeout)
+            return false;
+
+        std::unique_ptr<Slot> loaded;
+
+        try {
+            loaded = m_pending.get();
+        }
+        catch (const TD::BadData &error) {
+            printf("[reload] %s rejected: %s\n", m_pendingName.c_str(), error.what());
+        }
+
+        auto swapped = loaded != nullptr;
+
+        if (swapped) {
+            loaded->assets->registry.uploadAll();
+
+            // frees the old scene and its GPU buffers
+            m_current = std::move(loaded);
+            m_generation++;
+        }
+
+        if (!m_queued.empty()) {
+            request(m_queued);
+            m_queued.clear();
+        }
+
+        return swapped;
+    }
+
+    bool isLoading() const {
+        return m_pending.valid();
+    }
+
+    // Bumped on every swap, screens compare it to know when to rebuild
+    int generation() const {
+        return m_generation;
+    }
+
+    const std::string &sceneName() const {
+        return m_current->name;
+    }
+
+    TD::Scene &scene() {
+        return *m_current->scene;
+    }
+
+    SceneAssets &assets() {
+        return *m_current->assets;
+    }
+
+    const Arena &arena() const {
+        return *m_current->arena;
+    }
+
+    // The scene being shown; one still loading is not looked at
+    void accountMemory(MemoryReport &report) const {
+        auto subsystem = "scene " + m_current->name;
+
+        m_current->scene->accountMemory(report, subsystem);
+        m_current->assets->accountMemory(report, subsystem);
+    }
+
+private:
+    // The assets point into the scene, both live on the heap so neither
+    // moves when the slot does. The arena is first, to go last.
+    struct Slot {
+        std::unique_ptr<Arena> arena;
+        std::string name;
+        std::unique_ptr<TD::Scene> scene;
+        std::unique_ptr<SceneAssets> assets;
+    };
+
+    std::unique_ptr<Slot> load(const std::string &name) const {
+        auto slot = std::make_unique<Slot>();
+
+        slot->arena = std::make_unique<Arena>("scene " + name, SceneArenaBytes);
+        slot->name = name;
+        slot->scene = std::make_unique<TD::Scene>(m_res.loadScene(name, slot->arena.get()));
+        slot->assets = std::make_unique<SceneAssets>(m_res, m_palette, *slot->scene);
+        slot->scene->decoded();
+
+        return slot;
+    }
+
+    TD::Resources &m_res;
+    TD::GamePalette &m_palette;
+
+    std::unique_ptr<Slot> m_current;
+    std::future<std::unique_ptr<Slot>> m_pending;
+    std::string m_pendingName;
+    std::string m_queued;
+    int m_generation = 0;
+};
@@ -0,0 +1,439 @@
+//
+//  SoftwareRenderer.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "MeshBuilder.h"
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TD_SOFTWARE_SSE2 1
+#else
+#define TD_SOFTWARE_SSE2 0
+#endif
+
+// Draws CPU meshes into a framebuffer the size of the game's screen, or a
+// multiple of it, with no GPU involved. Same camera conventions as raylib's
+// BeginMode3D, so a frame matches what the GL path shows.
+//
+// drawMesh() transforms, clips and sets up the triangles. render() bins
+// them into TileSize tiles and rasterizes the tiles on the thread pool.
+// Each tile keeps submission order, so the output does not depend on the
+// number of threads. The SSE2 rows and the scalar fallback compute the
+// edge functions the same way and give the same pixels.
+//
+// Depth ordering tests a z-buffer. Painter ordering sorts the frame's
+// triangles far to near and draws them all, like the game does.
+
+class SoftwareRenderer {
+public:
+    static const int TileSize = 32;
+
+    enum class Ordering {
+        Depth,
+        Painter,
+    };
+
+    SoftwareRenderer(int width, int height, ThreadPool &pool = ThreadPool::shared())
+        : m_width(width)
+        , m_height(height)
+        , m_tilesX((width + TileSize - 1) / TileSize)
+        , m_tilesY((height + TileSize - 1) / TileSize)
+        , m_pool(pool)
+        , m_color(width * height)
+        , m_depth(width * height)
+        , m_bins(m_tilesX * m_tilesY)
+    {
+        m_viewProjection = MatrixIdentity();
+    }
+
+    int width() const  { return m_width; }
+    int height() const { return m_height; }
+
+    Ordering ordering() const {
+        return m_ordering;
+    }
+
+    void setOrdering(Ordering ordering) {
+        m_ordering = ordering;
+    }
+
+    // As BeginMode3D would set it up for this framebuffer
+    void setCamera(const Camera &camera) {
+        const double Near = 0.01;
+        const double Far = 1000.0;
+
+        auto aspect = (double)m_width / (double)m_height;
+
+        auto view = MatrixLookAt(camera.position, camera.target, camera.up);
+        auto projection = MatrixPerspective(camera.fovy * DEG2RAD, aspect, Near, Far);
+
+        m_viewProjection = MatrixMultiply(view, projection);
+    }
+
+    void clear(Color color) {
+        std::fill(m_color.begin(), m_color.end(), pack(color.r, color.g, color.b));
+        std::fill(m_depth.begin(), m_depth.end(), std::numeric_limits<float>::infinity());
+
+        m_triangles.clear();
+    }
+
+    void drawMesh(const CpuMesh &mesh, const Matrix &transform) {
+        auto mvp = MatrixMultiply(transform, m_viewProjection);
+
+        m_clipVertices.resize(mesh.vertexCount());
+
+        for (int i = 0; i < mesh.vertexCount(); i++) {
+            auto x = mesh.vertices[i * 3 + 0];
+            auto y = mesh.vertices[i * 3 + 1];
+            auto z = mesh.vertices[i * 3 + 2];
+
+            m_clipVertices[i] = {
+                mvp.m0 * x + mvp.m4 * y + mvp.m8  * z + mvp.m12,
+                mvp.m1 * x + mvp.m5 * y + mvp.m9  * z + mvp.m13,
+                mvp.m2 * x + mvp.m6 * y + mvp.m10 * z + mvp.m14,
+                mvp.m3 * x + mvp.m7 * y + mvp.m11 * z + mvp.m15,
+            };
+        }
+
+        for (int i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            auto first = mesh.indices[i];
+            auto color = pack(mesh.colors[first * 4 + 0],
+                              mesh.colors[first * 4 + 1],
+                              mesh.colors[first * 4 + 2]);
+
+            clipTriangle(m_clipVertices[first],
+                         m_clipVertices[mesh.indices[i + 1]],
+                         m_clipVertices[mesh.indices[i + 2]],
+                         color);
+        }
+    }
+
+    // Rasterizes everything drawn since clear()
+    void render() {
+        if (m_ordering == Ordering::Painter) {
+            std::stable_sort(m_triangles.begin(), m_triangles.end(), [](auto &a, auto &b) {
+                return a.depth > b.depth;
+            });
+        }
+
+        for (auto &bin : m_bins)
+            bin.clear();
+
+        for (int i = 0; i < m_triangles.size(); i++) {
+            auto &t = m_triangles[i];
+
+            for (int ty = t.minY / TileSize; ty <= t.maxY / TileSize; ty++) {
+                for (int tx = t.minX / TileSize; tx <= t.maxX / TileSize; tx++)
+                    m_bins[ty * m_tilesX + tx].push_back(i);
+            }
+        }
+
+        m_pool.parallelFor((int)m_bins.size(), [this](int tile) {
+            rasterizeTile(tile);
+        });
+
+        m_renderedTriangles = (int)m_triangles.size();
+        m_triangles.clear();
+    }
+
+    // Triangles that survived clipping in the last render()
+    int triangleCount() const {
+        return m_renderedTriangles;
+    }
+
+    // R8G8B8A8 rows, top first
+    const uint32_t *pixels() const {
+        return m_color.data();
+    }
+
+    Image image() {
+        return (Image) {
+            .data = m_color.data(),
+            .width = m_width,
+            .height = m_height,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+        };
+    }
+
+private:
+    struct ClipVertex {
+        float x, y, z, w;
+    };
+
+    struct ScreenVertex {
+        float x, y, z;
+    };
+
+    // Edge i is E(x, y) = a[i] * x + b[i] * y + c[i], positive inside and
+    // zero on the vertex opposite to it.
+    struct Triangle {
+        float a[3], b[3], c[3];
+        bool topLeft[3];
+        float za, zb, zc;
+        float depth;
+        uint32_t color;
+        int minX, minY, maxX, maxY;
+    };
+
+    static uint32_t pack(uint8_t r, uint8_t g, uint8_t b) {
+        uint8_t bytes[4] = { r, g, b, 0xff };
+        uint32_t value;
+        memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    void clipTriangle(ClipVertex v0, ClipVertex v1, ClipVertex v2, uint32_t color) {
+        auto outside = [&](auto distance) {
+            return distance(v0) < 0 && distance(v1) < 0 && distance(v2) < 0;
+        };
+
+        if (outside([](auto &v) { return v.w - v.x; }) ||
+            outside([](auto &v) { return v.w + v.x; }) ||
+            outside([](auto &v) { return v.w - v.y; }) ||
+            outside([](auto &v) { return v.w + v.y; }))
+        {
+            return;
+        }
+
+        ClipVertex polygon[8] = { v0, v1, v2 };
+        ClipVertex clipped[8];
+        int count = 3;
+
+        count = clipPolygon(polygon, count, clipped, [](auto &v) { return v.z + v.w; });
+        count = clipPolygon(clipped, count, polygon, [](auto &v) { return v.w - v.z; });
+
+        if (count < 3)
+            return;
+
+        ScreenVertex screen[8];
+
+        for (int i = 0; i < count; i++) {
+            auto &v = polygon[i];
+
+            screen[i] = {
+                (v.x / v.w * .5f + .5f) * m_width,
+                (.5f - v.y / v.w * .5f) * m_height,
+                v.z / v.w,
+            };
+        }
+
+        for (int i = 1; i + 1 < count; i++)
+            setup(screen[0], screen[i], screen[i + 1], color);
+    }
+
+    // One Sutherland-Hodgman pass against distance(v) >= 0
+    template <typename Distance>
+    static int clipPolygon(const ClipVertex *in, int count, ClipVertex *out, Distance distance) {
+        int result = 0;
+
+        for (int i = 0; i < count; i++) {
+            auto &a = in[i];
+            auto &b = in[(i + 1) % count];
+            auto da = distance(a);
+            auto db = distance(b);
+
+            if (da >= 0)
+                out[result++] = a;
+
+            if ((da >= 0) != (db >= 0)) {
+                auto t = da / (da - db);
+
+                out[result++] = {
+                    a.x + (b.x - a.x) * t,
+                    a.y + (b.y - a.y) * t,
+                    a.z + (b.z - a.z) * t,
+                    a.w + (b.w - a.w) * t,
+                };
+            }
+        }
+
+        return result;
+    }
+
+    void setup(ScreenVertex v0, ScreenVertex v1, ScreenVertex v2, uint32_t color) {
+        auto area = (v2.x - v0.x) * (v1.y - v0.y) - (v2.y - v0.y) * (v1.x - v0.x);
+
+        if (area == 0)
+            return;
+
+        // no backface culling, wind everything the same way
+        if (area < 0) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        Triangle t;
+        ScreenVertex v[3] = { v0, v1, v2 };
+
+        t.minX = std::max(0,            (int)std::floor(std::min({ v0.x, v1.x, v2.x })));
+        t.minY = std::max(0,            (int)std::floor(std::min({ v0.y, v1.y, v2.y })));
+        t.maxX = std::min(m_width - 1,  (int)std::ceil (std::max({ v0.x, v1.x, v2.x })));
+        t.maxY = std::min(m_height - 1, (int)std::ceil (std::max({ v0.y, v1.y, v2.y })));
+
+        if (t.minX > t.maxX || t.minY > t.maxY)
+            return;
+
+        t.za = t.zb = t.zc = 0;
+
+        for (int i = 0; i < 3; i++) {
+            auto &from = v[(i + 1) % 3];
+            auto &to = v[(i + 2) % 3];
+
+            t.a[i] = to.y - from.y;
+            t.b[i] = from.x - to.x;
+            t.c[i] = -from.x * t.a[i] - from.y * t.b[i];
+
+            // pixels on an edge shared by two triangles go to only one
+            t.topLeft[i] = t.a[i] > 0 || (t.a[i] == 0 && t.b[i] > 0);
+
+            t.za += t.a[i] * v[i].z / area;
+            t.zb += t.b[i] * v[i].z / area;
+            t.zc += t.c[i] * v[i].z / area;
+        }
+
+        t.depth = (v0.z + v1.z + v2.z) / 3;
+        t.color = color;
+
+        m_triangles.push_back(t);
+    }
+
+    void rasterizeTile(int tile) {
+        auto x0 = (tile % m_tilesX) * TileSize;
+        auto y0 = (tile / m_tilesX) * TileSize;
+        auto x1 = std::min(x0 + TileSize, m_width);
+        auto y1 = std::min(y0 + TileSize, m_height);
+
+        for (auto index : m_bins[tile]) {
+            auto &t = m_triangles[index];
+
+            auto begin = std::max(t.minX, x0);
+            auto end = std::min(t.maxX + 1, x1);
+
+            for (int y = std::max(t.minY, y0); y < std::min(t.maxY + 1, y1); y++)
+                rasterizeRow(t, y, begin, end);
+        }
+    }
+
+    void rasterizeRow(const Triangle &t, int y, int begin, int end) {
+        auto py = y + .5f;
+        auto depthTest = m_ordering == Ordering::Depth;
+
+        float row[3];
+        for (int i = 0; i < 3; i++)
+            row[i] = t.b[i] * py + t.c[i];
+
+        auto zRow = t.zb * py + t.zc;
+
+        auto color = m_color.data() + y * m_width;
+        auto depth = m_depth.data() + y * m_width;
+
+        int x = begin;
+
+#if TD_SOFTWARE_SSE2
+        const auto zero = _mm_setzero_ps();
+        const auto lanes = _mm_setr_ps(.5f, 1.5f, 2.5f, 3.5f);
+        const auto fill = _mm_set1_epi32((int)t.color);
+
+        __m128 a[3], r[3], topLeft[3];
+
+        for (int i = 0; i < 3; i++) {
+            a[i] = _mm_set1_ps(t.a[i]);
+            r[i] = _mm_set1_ps(row[i]);
+            topLeft[i] = _mm_castsi128_ps(_mm_set1_epi32(t.topLeft[i] ? -1 : 0));
+        }
+
+        const auto za = _mm_set1_ps(t.za);
+        const auto zr = _mm_set1_ps(zRow);
+
+        for (; x + 4 <= end; x += 4) {
+            auto px = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+            auto mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+            for (int i = 0; i < 3; i++) {
+                auto e = _mm_add_ps(_mm_mul_ps(a[i], px), r[i]);
+                auto inside = _mm_or_ps(_mm_cmpgt_ps(e, zero), _mm_and_ps(_mm_cmpeq_ps(e, zero), topLeft[i]));
+                mask = _mm_and_ps(mask, inside);
+            }
+
+            if (_mm_movemask_ps(mask) == 0)
+                continue;
+
+            if (depthTest) {
+                auto z = _mm_add_ps(_mm_mul_ps(za, px), zr);
+                auto old = _mm_loadu_ps(depth + x);
+
+                mask = _mm_and_ps(mask, _mm_cmplt_ps(z, old));
+
+                if (_mm_movemask_ps(mask) == 0)
+                    continue;
+
+                _mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, old)));
+            }
+
+            auto pixels = (__m128i *)(color + x);
+            auto select = _mm_castps_si128(mask);
+            auto old = _mm_loadu_si128(pixels);
+
+            _mm_storeu_si128(pixels, _mm_or_si128(_mm_and_si128(select, fill), _mm_andnot_si128(select, old)));
+        }
+#endif
+
+        for (; x < end; x++) {
+            auto px = x + .5f;
+            auto inside = true;
+
+            for (int i = 0; i < 3; i++) {
+                auto e = t.a[i] * px + row[i];
+                inside = inside && (e > 0 || (e == 0 && t.topLeft[i]));
+            }
+
+            if (!inside)
+                continue;
+
+            if (depthTest) {
+                auto z = t.za * px + zRow;
+
+                if (!(z < depth[x]))
+                    continue;
+
+                depth[x] = z;
+            }
+
+            color[x] = t.color;
+        }
+    }
+
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    ThreadPool &m_pool;
+
+    Ordering m_ordering = Ordering::Depth;
+    Matrix m_viewProjection;
+
+    std::vector<uint32_t> m_color;
+    std::vector<float> m_depth;
+
+    std::vector<ClipVertex> m_clipVertices;
+    std::vector<Triangle> m_triangles;
+    std::vector<std::vector<int>> m_bins;
+    int m_renderedTriangles = 0;
+};
@@ -0,0 +1,277 @@
+//
+//  TextLabels.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "GpuResources.h"
+
+// 3D text laid out like raylib's 3D text example, with every label baked into shared
+// meshes so they all go out in one draw with the font texture bound once.
+// A label is laid out again only when its text or placement change, and
+// the meshes are packed again when that or the set of labels shown does.
+//
+// Only the front faces are built: backface culling is off everywhere.
+
+class TextLabels {
+public:
+    // Text on the XZ plane of transform, lines going down +Z
+    void set(int id, const std::string &text, const Matrix &transform, float fontSize, Color color) {
+        if (id >= (int)m_labels.size())
+            m_labels.resize(id + 1);
+
+        auto &label = m_labels[id];
+
+        if (label.text == text &&
+            label.fontSize == fontSize &&
+            memcmp(&label.color, &color, sizeof(Color)) == 0 &&
+            memcmp(&label.transform, &transform, sizeof(Matrix)) == 0)
+        {
+            return;
+        }
+
+        label.text = text;
+        label.transform = transform;
+        label.fontSize = fontSize;
+        label.color = color;
+        label.glyphs = 0;
+        label.laidOut = false;
+
+        for (auto c : text) {
+            if (c != ' ' && c != '\t' && c != '\n')
+                label.glyphs++;
+        }
+
+        m_dirty = true;
+    }
+
+    // Only these get drawn, like the objects that came through culling
+    void show(const std::vector<int> &ids) {
+        if (ids == m_shown)
+            return;
+
+        m_shown = ids;
+        m_dirty = true;
+    }
+
+    void clear() {
+        m_labels.clear();
+        m_shown.clear();
+        m_chunks.clear();
+        m_dirty = false;
+    }
+
+    // Of the labels shown
+    int glyphCount() const {
+        int count = 0;
+
+        for (auto id : m_shown) {
+            if (id < (int)m_labels.size())
+                count += m_labels[id].glyphs;
+        }
+
+        return count;
+    }
+
+    // Main thread, with the window open
+    void draw() {
+        auto font = GetFontDefault();
+
+        if (m_dirty)
+            rebuild(font);
+
+        for (auto &chunk : m_chunks)
+            chunk.gpu->draw(MatrixIdentity(), font.texture);
+    }
+
+private:
+    // 16 bit indices
+    static const int MaxQuadsPerChunk = 0x10000 / 4;
+
+    struct Label {
+        std::string text;
+        Matrix transform;
+        float fontSize = 0;
+        Color color = { 0 };
+        int glyphs = 0;
+
+        bool laidOut = false;
+        std::vector<float> vertices;
+        std::vector<float> texcoords;
+    };
+
+    struct Chunk {
+        std::vector<float> vertices;
+        std::vector<float> texcoords;
+        std::vector<uint8_t> colors;
+        std::vector<unsigned short> indices;
+        std::optional<GpuMesh> gpu;
+    };
+
+    void rebuild(const Font &font) {
+        TD_PROFILE_SCOPE("label upload");
+
+        m_chunks.clear();
+        m_chunks.emplace_back();
+
+        for (auto id : m_shown) {
+            if (id >= (int)m_labels.size())
+                continue;
+
+            auto &label = m_labels[id];
+
+            if (!label.laidOut)
+                layout(label, font);
+
+            auto quads = (int)label.vertices.size() / 12;
+
+            if (quads == 0)
+                continue;
+
+            if (m_chunks.back().vertices.size() / 12 + quads > MaxQuadsPerChunk)
+                m_chunks.emplace_back();
+
+            append(m_chunks.back(), label);
+        }
+
+        for (auto &chunk : m_chunks)
+            upload(chunk);
+
+        m_chunks.erase(std::remove_if(m_chunks.begin(), m_chunks.end(), [](auto &chunk) {
+            return !chunk.gpu;
+        }), m_chunks.end());
+
+        m_dirty = false;
+    }
+
+    // raylib's 3D text example, emitting world space quads
+    static void layout(Label &label, const Font &font) {
+        const int FontSpacing = 1;
+
+        label.vertices.clear();
+        label.texcoords.clear();
+        label.laidOut = true;
+
+        if (font.texture.id == 0)
+            return;
+
+        auto scale = label.fontSize / (float)font.baseSize;
+        auto text = label.text.c_str();
+        auto length = (int)label.text.size();
+
+        float offsetX = 0;
+        float offsetY = 0;
+
+        for (int i = 0; i < length;) {
+            int codepointByteCount = 0;
+            int codepoint = GetCodepoint(&text[i], &codepointByteCount);
+            int index = GetGlyphIndex(font, codepoint);
+
+            if (codepoint == 0x3f)
+                codepointByteCount = 1;
+
+            if (codepoint == '\n') {
+                offsetY += scale;
+                offsetX = 0;
+            }
+            else {
+                if (codepoint != ' ' && codepoint != '\t')
+                    addGlyph(label, font, index, offsetX, offsetY, scale);
+
+                auto advance = font.glyphs[index].advanceX == 0
+                    ? font.recs[index].width
+                    : font.glyphs[index].advanceX;
+
+                offsetX += (advance + FontSpacing) / (float)font.baseSize * scale;
+            }
+
+            i += codepointByteCount;
+        }
+    }
+
+    static void addGlyph(Label &label, const Font &font, int index, float offsetX, float offsetY, float scale) {
+        auto &glyph = font.glyphs[index];
+        auto &rec = font.recs[index];
+        auto padding = (float)font.glyphPadding;
+
+        auto x = offsetX + (glyph.offsetX - padding) / font.baseSize * scale;
+        auto z = offsetY + (glyph.offsetY - padding) / font.baseSize * scale;
+        auto width  = (rec.width  + 2 * padding) / font.baseSize * scale;
+        auto height = (rec.height + 2 * padding) / font.baseSize * scale;
+
+        auto tx = (rec.x - padding) / font.texture.width;
+        auto ty = (rec.y - padding) / font.texture.height;
+        auto tw = (rec.x + rec.width  + padding) / font.texture.width;
+        auto th = (rec.y + rec.height + padding) / font.texture.height;
+
+        Vector3 corners[4] = {
+            { x,         0, z          },
+            { x,         0, z + height },
+            { x + width, 0, z + height },
+            { x + width, 0, z          },
+        };
+
+        float uvs[8] = { tx, ty,  tx, th,  tw, th,  tw, ty };
+
+        for (int i = 0; i < 4; i++) {
+            auto world = Vector3Transform(corners[i], label.transform);
+
+            label.vertices.insert(label.vertices.end(), { world.x, world.y, world.z });
+            label.texcoords.insert(label.texcoords.end(), { uvs[i * 2], uvs[i * 2 + 1] });
+        }
+    }
+
+    static void append(Chunk &chunk, const Label &label) {
+        auto first = (unsigned short)(chunk.vertices.size() / 3);
+        auto quads = (int)label.vertices.size() / 12;
+
+        chunk.vertices.insert(chunk.vertices.end(), label.vertices.begin(), label.vertices.end());
+        chunk.texcoords.insert(chunk.texcoords.end(), label.texcoords.begin(), label.texcoords.end());
+
+        for (int i = 0; i < quads * 4; i++) {
+            chunk.colors.insert(chunk.colors.end(), { label.color.r, label.color.g, label.color.b, label.color.a });
+        }
+
+        for (int q = 0; q < quads; q++) {
+            unsigned short v = first + q * 4;
+            chunk.indices.insert(chunk.indices.end(), { v, (unsigned short)(v + 1), (unsigned short)(v + 2),
+                                                        v, (unsigned short)(v + 2), (unsigned short)(v + 3) });
+        }
+    }
+
+    static void upload(Chunk &chunk) {
+        if (chunk.indices.empty())
+            return;
+
+        Mesh mesh = { 0 };
+        mesh.vertexCount   = (int)chunk.vertices.size() / 3;
+        mesh.triangleCount = (int)chunk.indices.size() / 3;
+        mesh.vertices      = chunk.vertices.data();
+        mesh.texcoords     = chunk.texcoords.data();
+        mesh.colors        = chunk.colors.data();
+        mesh.indices       = chunk.indices.data();
+
+        auto bytes = (chunk.vertices.size() + chunk.texcoords.size()) * sizeof(float)
+                   + chunk.colors.size() * sizeof(uint8_t)
+                   + chunk.indices.size() * sizeof(unsigned short);
+
+        chunk.gpu.emplace(mesh, (long long)bytes);
+    }
+
+    std::vector<Label> m_labels;
+    std::vector<int> m_shown;
+    std::vector<Chunk> m_chunks;
+    bool m_dirty = false;
+};
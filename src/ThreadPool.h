@@ -0,0 +1,142 @@
+//
+//  ThreadPool.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for CPU-only jobs (mesh building and the
+// like). Nothing submitted here may call into raylib.
+//
+// The WASM build is not compiled with pthreads, so there the pool has no
+// workers and every job runs inline on the calling thread.
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define TD_THREADS_AVAILABLE 0
+#else
+#define TD_THREADS_AVAILABLE 1
+#endif
+
+class ThreadPool {
+public:
+    static ThreadPool &shared() {
+        static ThreadPool pool(DefaultWorkerCount());
+        return pool;
+    }
+
+    explicit ThreadPool(int workerCount) {
+        for (int i = 0; i < workerCount; i++) {
+            m_workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+
+        m_wakeUp.notify_all();
+
+        for (auto &worker : m_workers)
+            worker.join();
+    }
+
+    int workerCount() const {
+        return (int)m_workers.size();
+    }
+
+    void submit(std::function<void()> job) {
+        if (m_workers.empty()) {
+            job();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(std::move(job));
+        }
+
+        m_wakeUp.notify_one();
+    }
+
+    // Runs body(i) for every i in [0, count) and waits for all of them. The
+    // calling thread picks up work too. Not to be called from a pool job.
+    template <typename Body>
+    void parallelFor(int count, Body body) {
+        std::atomic<int> next { 0 };
+
+        auto drain = [&] {
+            for (int i = next++; i < count; i = next++) {
+                body(i);
+            }
+        };
+
+        auto helpers = std::max(0, std::min(workerCount(), count - 1));
+
+        std::mutex finishedMutex;
+        std::condition_variable finished;
+        int helpersRunning = helpers;
+
+        for (int i = 0; i < helpers; i++) {
+            submit([&] {
+                drain();
+
+                std::lock_guard<std::mutex> lock(finishedMutex);
+                helpersRunning--;
+                finished.notify_one();
+            });
+        }
+
+        drain();
+
+        std::unique_lock<std::mutex> lock(finishedMutex);
+        finished.wait(lock, [&] { return helpersRunning == 0; });
+    }
+
+private:
+    static int DefaultWorkerCount() {
+#if TD_THREADS_AVAILABLE
+        auto cores = (int)std::thread::hardware_concurrency();
+        return std::max(cores - 1, 1);
+#else
+        return 0;
+#endif
+    }
+
+    void work() {
+        while (true) {
+            std::function<void()> job;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeUp.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+
+                if (m_stopping && m_jobs.empty())
+                    return;
+
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+
+            job();
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    bool m_stopping = false;
+};
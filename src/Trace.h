@@ -0,0 +1,227 @@
+//
+//  Trace.h
+//  testdrive
+//
+//  Created by agent on 19/10/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Step by step tracing for the reverse engineering ports, meant to be
+// diffed against the emulator's traces. Everything is decided at compile
+// time: with the default TD_TRACE_LEVEL of 0 every TD_TRACE is discarded
+// and its arguments never evaluated.
+//
+//   TD_TRACE_LEVEL       1 traces the branches taken, 2 adds register values
+//   TD_TRACE_CATEGORIES  mask of TraceCategory values, all of them if unset
+//
+// When on, records go into a lock-free ring and are only formatted when
+// dumped, in the same text the printf calls used to produce.
+
+#ifndef TD_TRACE_LEVEL
+#define TD_TRACE_LEVEL 0
+#endif
+
+#ifndef TD_TRACE_CATEGORIES
+#define TD_TRACE_CATEGORIES 0xffffffff
+#endif
+
+namespace TD {
+
+enum class TraceCategory : uint32_t {
+    Barfs     = 1 << 0,
+    Resources = 1 << 1,
+};
+
+enum TraceLevel {
+    TraceSteps  = 1,
+    TraceValues = 2,
+};
+
+constexpr bool TraceEnabled(TraceCategory category, int level) {
+    return level <= TD_TRACE_LEVEL && (TD_TRACE_CATEGORIES & (uint32_t)category) != 0;
+}
+
+// The format has to be a string literal: only the pointer is stored.
+
+class TraceBuffer {
+public:
+    static const int Capacity = 1 << 16;
+    static const int MaxValues = 4;
+
+    static TraceBuffer &shared() {
+        static TraceBuffer buffer;
+        return buffer;
+    }
+
+    template <typename... Values>
+    void record(TraceCategory category, const char *format, Values... values) {
+        static_assert(sizeof...(Values) <= MaxValues, "too many values for a trace record");
+
+        auto index = m_next.fetch_add(1, std::memory_order_relaxed);
+        auto &slot = m_records[index & (Capacity - 1)];
+
+        slot.format = format;
+        slot.category = (uint32_t)category;
+        slot.count = sizeof...(Values);
+
+        uint32_t unpacked[MaxValues + 1] = { (uint32_t)values... };
+        for (int i = 0; i < MaxValues; i++)
+            slot.values[i] = unpacked[i];
+
+        slot.sequence.store(index + 1, std::memory_order_release);
+    }
+
+    void clear() {
+        for (int i = 0; i < Capacity; i++)
+            m_records[i].sequence.store(0, std::memory_order_relaxed);
+
+        m_next.store(0);
+    }
+
+    // Oldest first; records overwritten while dumping are skipped
+    void dump(FILE *out) const {
+        forEach([&](const Slot &slot) {
+            print(out, slot.format, slot.values);
+        });
+    }
+
+    // Binary dump: the formats once, then 20 bytes per record.
+    bool save(const char *path) const {
+        auto file = fopen(path, "wb");
+
+        if (!file)
+            return false;
+
+        std::map<const char *, uint16_t> formatIds;
+        std::vector<const char *> formats;
+
+        forEach([&](const Slot &slot) {
+            if (formatIds.emplace(slot.format, formats.size()).second)
+                formats.push_back(slot.format);
+        });
+
+        fwrite(Magic, 1, sizeof(Magic), file);
+
+        uint32_t formatCount = (uint32_t)formats.size();
+        fwrite(&formatCount, sizeof(formatCount), 1, file);
+
+        for (auto format : formats) {
+            uint16_t length = (uint16_t)strlen(format);
+            fwrite(&length, sizeof(length), 1, file);
+            fwrite(format, 1, length, file);
+        }
+
+        forEach([&](const Slot &slot) {
+            FileRecord record = { formatIds[slot.format], (uint8_t)slot.category, slot.count };
+
+            for (int i = 0; i < MaxValues; i++)
+                record.values[i] = slot.values[i];
+
+            fwrite(&record, sizeof(record), 1, file);
+        });
+
+        fclose(file);
+        return true;
+    }
+
+    // Prints a file written by save() as text
+    static bool print(const char *path, FILE *out) {
+        auto file = fopen(path, "rb");
+
+        if (!file)
+            return false;
+
+        char magic[sizeof(Magic)];
+        uint32_t formatCount = 0;
+
+        if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+            memcmp(magic, Magic, sizeof(Magic)) != 0 ||
+            fread(&formatCount, sizeof(formatCount), 1, file) != 1)
+        {
+            fclose(file);
+            return false;
+        }
+
+        std::vector<std::string> formats(formatCount);
+
+        for (auto &format : formats) {
+            uint16_t length = 0;
+            fread(&length, sizeof(length), 1, file);
+
+            format.resize(length);
+            fread(&format[0], 1, length, file);
+        }
+
+        FileRecord record;
+
+        while (fread(&record, sizeof(record), 1, file) == 1) {
+            if (record.format < formats.size())
+                TraceBuffer::print(out, formats[record.format].c_str(), record.values);
+        }
+
+        fclose(file);
+        return true;
+    }
+
+private:
+    static constexpr char Magic[8] = { 'T', 'D', 'T', 'R', 'A', 'C', 'E', '1' };
+
+    struct Slot {
+        std::atomic<uint64_t> sequence { 0 };
+        const char *format;
+        uint32_t values[MaxValues];
+        uint32_t category;
+        uint8_t count;
+    };
+
+    #pragma pack(push, 1)
+    struct FileRecord {
+        uint16_t format;
+        uint8_t category;
+        uint8_t count;
+        uint32_t values[MaxValues];
+    };
+    #pragma pack(pop)
+
+    TraceBuffer()
+        : m_records(new Slot[Capacity])
+    { }
+
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        uint64_t next = m_next.load(std::memory_order_acquire);
+        uint64_t first = next > Capacity ? next - Capacity : 0;
+
+        for (auto index = first; index < next; index++) {
+            auto &slot = m_records[index & (Capacity - 1)];
+
+            if (slot.sequence.load(std::memory_order_acquire) == index + 1)
+                visit(slot);
+        }
+    }
+
+    static void print(FILE *out, const char *format, const uint32_t *v) {
+        fprintf(out, format, v[0], v[1], v[2], v[3]);
+    }
+
+    std::unique_ptr<Slot[]> m_records;
+    std::atomic<uint64_t> m_next { 0 };
+};
+
+}
+
+#define TD_TRACE(category, level, ...)                                                  \
+    do {                                                                                \
+        if constexpr (TD::TraceEnabled(TD::TraceCategory::category, level))             \
+            TD::TraceBuffer::shared().record(TD::TraceCategory::category, __VA_ARGS__); \
+    } while (0)
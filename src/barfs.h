@@ -7,10 +7,22 @@
 
 #pragma once
 
+#include <array>
+#include <cstdio>
+#include <vector>
+
 #include "Scene.h"
+#include "Trace.h"
 
 // Maybe some sort of sprite decompression / decrption routine
 // used for billboards in the 3d world
+//
+// Port of the routine at f68:25ed. The "course data" in one_dat is a
+// table of billboard bitmaps (the sprites tiles place in the world, see
+// Sprite::a): an 8 byte header per element, then per row an offset to its
+// pixels and the offset its run ends at. For each element the game builds
+// a set of scaled down copies, one per distance step in
+// barfs_course_data_lut_1.
 
 const uint8_t barfs_course_data_lut_1[] = {
     0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
@@ -41,313 +53,266 @@ const uint8_t barfs_boh_lut_2[] = {
     0x14, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
 };
 
-const int buffer2_size = 0xd000;
-uint8_t buffer2[buffer2_size];
-
-uint8_t rol_buffer[30] = { 0 }; // ds:b7cb
-
-void init_rol_buffer(TD::Scene& scene,
-                     uint8_t *byte_3a8f2,
-                     uint8_t *byte_3a8f3)
-{
-    printf("[init_rol_buffer]\n\n");
-    printf("  0F68:2d1a");
-
-    uint8_t ah = *byte_3a8f2;
+namespace TD {
 
-    if (ah >= 0x18) {
-        printf("    0F68:2d23");
+// One scaled copy of an element. scale is the distance step the game
+// passes in byte_3a8f2; doublings and rolMasks are what init_rol_buffer
+// derives from it (byte_3a8f3 and ds:b7cb).
 
-        ah = ah - 0x18;
-        *byte_3a8f3 = *byte_3a8f3 + 1;
+struct CourseDataLevel {
+    uint8_t scale;
+    uint8_t doublings;
+    std::array<uint8_t, 30> rolMasks;
 
-        if (ah >= 0x18) {
-            printf("      0F68:2d2f");
-            ah = ah - 0x18;
-            *byte_3a8f3 = *byte_3a8f3 + 1;
-        }
+    bool operator==(const CourseDataLevel &other) const {
+        return doublings == other.doublings && rolMasks == other.rolMasks;
     }
+};
 
-    printf("  0F68:2d36");
-
-    uint16_t bx = 0;
-
-    if (ah < 0x18) {
-        printf("    0F68:2d3d");
-        ah = 0x17 - ah;
-        bx = ah * 10;
-    }
-
-    rol_buffer[0x00] = barfs_boh_lut_2[bx + 0];
-    rol_buffer[0x01] = barfs_boh_lut_2[bx + 1];
-
-    rol_buffer[0x07] = barfs_boh_lut_2[bx + 0];
-    rol_buffer[0x08] = barfs_boh_lut_2[bx + 0];
-
-    rol_buffer[0x0e] = barfs_boh_lut_2[bx + 0];
-    rol_buffer[0x0f] = barfs_boh_lut_2[bx + 0];
-
-    rol_buffer[0x15] = barfs_boh_lut_2[bx + 0];
-    rol_buffer[0x16] = barfs_boh_lut_2[bx + 0];
-
-
-
-    rol_buffer[0x02] = barfs_boh_lut_2[bx + 2];
-    rol_buffer[0x03] = barfs_boh_lut_2[bx + 3];
-
-    rol_buffer[0x09] = barfs_boh_lut_2[bx + 2];
-    rol_buffer[0x0a] = barfs_boh_lut_2[bx + 3];
-
-    rol_buffer[0x10] = barfs_boh_lut_2[bx + 2];
-    rol_buffer[0x11] = barfs_boh_lut_2[bx + 3];
-
-    rol_buffer[0x17] = barfs_boh_lut_2[bx + 2];
-    rol_buffer[0x18] = barfs_boh_lut_2[bx + 3];
+struct CourseDataElement {
+    int index;
 
+    uint8_t width;
+    uint8_t height;
+    uint16_t rowOffsets;
+    uint16_t rowEnds;
 
+    // getCourseDataLut2(index) & 7: 0 builds one level per distance step,
+    // 2 and up a single one, 1 none at all
+    uint8_t mode;
 
-    rol_buffer[0x04] = barfs_boh_lut_2[bx + 4];
-    rol_buffer[0x05] = barfs_boh_lut_2[bx + 5];
+    // width * height palette indices, 0 is transparent. Rows shorter than
+    // the element are centred.
+    std::vector<uint8_t> pixels;
 
-    rol_buffer[0x0b] = barfs_boh_lut_2[bx + 4];
-    rol_buffer[0x0c] = barfs_boh_lut_2[bx + 5];
+    // The game's per element pointer table: one entry per distance step,
+    // pointing into levels. Consecutive steps that come out the same
+    // share their level, like the 0F68:26E0 branch does.
+    std::vector<int> levelForStep;
+    std::vector<CourseDataLevel> levels;
 
-    rol_buffer[0x12] = barfs_boh_lut_2[bx + 4];
-    rol_buffer[0x13] = barfs_boh_lut_2[bx + 5];
+    uint8_t pixel(int x, int y) const {
+        return pixels[y * width + x];
+    }
+};
 
-    rol_buffer[0x19] = barfs_boh_lut_2[bx + 5];
+// Decodes Scene::one_dat into CourseDataElement records. All the state the
+// original keeps in globals lives in the instance, so separate decoders
+// can run on separate threads.
 
+class CourseDataDecoder {
+public:
+    explicit CourseDataDecoder(const Scene &scene)
+        : m_scene(scene)
+        , m_file(scene.one_dat.get())
+        , m_data(*m_file)
+    { }
 
-    rol_buffer[0x06] = barfs_boh_lut_2[bx + 7];
-    rol_buffer[0x0d] = barfs_boh_lut_2[bx + 7];
-    rol_buffer[0x14] = barfs_boh_lut_2[bx + 7];
+    std::vector<CourseDataElement> decode() {
+        std::vector<CourseDataElement> elements;
 
-    uint8_t ch = barfs_boh_lut_2[bx + 6];
+        if (m_data.size() < 8)
+            return elements;
 
-    if (ah >= 0x18) {
-        printf("    0F68:2db2");
-        ah = ah - 0x18;
-        *byte_3a8f3 = 3;
+        auto count = GetWord(m_data, 6);
 
-        bx = 0;
+        TD_TRACE(Barfs, TraceValues, "scene011.dat > %04x %04x %04x %04x\n",
+              GetWord(m_data, 0), GetWord(m_data, 2), GetWord(m_data, 4), count);
+        TD_TRACE(Barfs, TraceValues, "getSingleCourseDataBoh 0x%x\n\n", m_scene.getSingleCourseDataBoh());
 
-        if (ah < 0x18) {
-            printf("    0F68:2dc1");
-            ah = 0x17 - ah;
-            bx = ah * 10;
+        // element 0 is the table header
+        for (int i = 1; i < count && (i + 1) * 8 <= m_data.size(); i++) {
+            TD_TRACE(Barfs, TraceValues, "\n    0F68:263A  --  bx = %4x\n", i);
+            elements.push_back(decodeElement(i));
         }
 
-        ch = barfs_boh_lut_2[bx + 7];
+        return elements;
     }
 
-    rol_buffer[0x1b] = ch;
-
-    rol_buffer[0x1c] = barfs_boh_lut_2[bx + 8];
-    rol_buffer[0x1d] = barfs_boh_lut_2[bx + 9];
-
-    printf("    0F68:2de7");
-    printf("[END -- single_course_data_element_inner]\n\n");
-}
+private:
+    CourseDataElement decodeElement(int index) {
+        CourseDataElement element;
 
-void single_course_data_element_inner_1(TD::Scene& scene) {
+        element.index      = index;
+        element.width      = GetByte(m_data, index * 8 + 0);
+        element.height     = GetByte(m_data, index * 8 + 1);
+        element.rowOffsets = GetWord(m_data, index * 8 + 2);
+        element.rowEnds    = GetWord(m_data, index * 8 + 4);
+        element.mode       = m_scene.getCourseDataLut2(index) & 7;
 
-}
+        decodePixels(element);
+        decodeLevels(element);
 
-void single_course_data_element_inner_2(TD::Scene& scene,
-                                        uint16_t element_header_second_word)
-{
-    printf("\n                [single_course_data_element_inner_2]\n");
-    printf("                0F68:2bb8\n");
+        return element;
+    }
 
-    uint8_t byte_3a7f6 = 0;
+    void decodePixels(CourseDataElement &element) {
+        element.pixels.assign(element.width * element.height, 0);
 
-    {
-        printf("                    0F68:2bc6\n");
-        uint8_t c0 = (rol_buffer[0x1d] & 0x80) >> 8;
+        for (int y = 0; y < element.height; y++) {
+            auto offsetAt = element.rowOffsets + y * 2;
+            auto endAt    = element.rowEnds + y * 2;
 
-        uint8_t c1 = (rol_buffer[0x1b] & 0x80) >> 8;
-        rol_buffer[0x1b] = (rol_buffer[0x1b] << 1) | c0;
+            if (offsetAt + 2 > m_data.size() || endAt + 2 > m_data.size())
+                break;
 
-        uint8_t c2 = (rol_buffer[0x1c] & 0x80) >> 8;
-        rol_buffer[0x1c] = (rol_buffer[0x1c] << 1) | c1;
+            int start  = GetWord(m_data, offsetAt);
+            int length = GetWord(m_data, endAt) - 0x40;
 
-        uint8_t c3 = (rol_buffer[0x1d] & 0x80) >> 8;
-        rol_buffer[0x1d] = (rol_buffer[0x1d] << 1) | c2;
+            length = length < 0 ? 0 : length;
+            length = length > element.width ? element.width : length;
+            length = start + length > m_data.size() ? (int)m_data.size() - start : length;
 
-        if (c3) {
-            printf("                        0F68:2bdc\n");
+            auto x0 = (element.width - length) / 2;
 
-            byte_3a7f6 = byte_3a7f6 + 1;
+            for (int x = 0; x < length; x++)
+                element.pixels[y * element.width + x0 + x] = GetByte(m_data, start + x);
         }
     }
 
-}
-
-void single_course_data_element(TD::Scene& scene,
-                                int element_index,
-                                uint16_t *output,
-                                uint8_t *byte_3a8f2,
-                                uint8_t *byte_3a8f3,
-                                uint16_t *word_3a7ff)
-{
-    /*
-    printf("\n            [single_course_data_element]\n");
-    printf("            0F68:26fe\n");
-
-    init_rol_buffer(scene, byte_3a8f2, byte_3a8f3);
+    // single_course_data
+    void decodeLevels(CourseDataElement &element) {
+        auto steps = m_scene.getSingleCourseDataBoh();
 
-    uint8_t  element_header_first_byte  = TD::GetByte(scene.one_dat, ((element_index * 8) + 0));
-    uint8_t  element_header_second_byte = TD::GetByte(scene.one_dat, ((element_index * 8) + 1));
+        TD_TRACE(Barfs, TraceValues, "        0F68:2685  --  ah = %2x\n", m_scene.getCourseDataLut2(element.index));
 
-    uint16_t element_header_second_word = TD::GetWord(scene.one_dat, ((element_index * 8) + 2));
-    uint16_t element_header_third_word  = TD::GetWord(scene.one_dat, ((element_index * 8) + 4));
+        if (element.mode == 0) {
+            TD_TRACE(Barfs, TraceSteps, "        0F68:26AD taken\n");
 
-    buffer2[*output] = element_header_first_byte;
-    *output = *output + 1;
+            for (int i = 0; i < steps && i < sizeof(barfs_course_data_lut_1); i++) {
+                auto level = makeLevel(barfs_course_data_lut_1[i]);
 
-    *word_3a7ff = *output;
-    *output = *output + 2;
+                if (!element.levels.empty() && element.levels.back() == level) {
+                    TD_TRACE(Barfs, TraceSteps, "                0F68:26E0 taken\n");
+                }
+                else {
+                    TD_TRACE(Barfs, TraceSteps, "                0F68:26EC taken\n");
+                    element.levels.push_back(level);
+                }
 
-    uint16_t word_3a7fd = *output;
-    *output = *output + element_header_first_byte;
+                element.levelForStep.push_back((int)element.levels.size() - 1);
+            }
+        }
+        else if (element.mode >= 2) {
+            TD_TRACE(Barfs, TraceSteps, "            0F68:268F taken\n");
 
-    if (*byte_3a8f3 < 1) {
-        printf("                0F68:274b\n");
-        single_course_data_element_inner_2(scene);
-    }
-    else {
-        printf("                0F68:2746\n");
-        single_course_data_element_inner_1(scene);
+            element.levels.push_back(makeLevel(0x17));
+            element.levelForStep.assign(steps, 0);
+        }
+        else {
+            TD_TRACE(Barfs, TraceSteps, "        0F68:268A taken\n");
+        }
     }
 
-    // ** //
-
-    (word_3a7fd = word_3a7fd);
-    (element_header_second_byte = element_header_second_byte);
-    (element_header_second_word = element_header_second_word);
-    (element_header_third_word = element_header_third_word);
-     */
-}
-
-void single_course_data(TD::Scene& scene, int element_index, uint16_t *output) {
-    printf("        [single_course_data]\n\n");
-
-    printf("        0F68:2674  --  al = %2x\n", element_index);
-    printf("        0F68:2677  --  cl = %2x\n", scene.getSingleCourseDataBoh());
-
-    int single_course_data_boh = scene.getSingleCourseDataBoh();
-
-    int some_offset = single_course_data_boh * 2;
-
-    printf("        0F68:2681  --  cl = %2x\n", some_offset);
-
-    uint8_t lut2 = scene.getCourseDataLut2(element_index);
-    printf("        0F68:2685  --  ah = %2x\n", lut2);
-
-    lut2 = lut2 & 7;
-    printf("        0F68:2688  --  ah = %2x\n", lut2);
-
-    if (lut2 == 0) {
-        printf("        0F68:26AD taken\n");
-
-        uint16_t bx = *output;
-        printf("        0F68:26AF  -- bx = %4x\n", bx);
-
-        *output += some_offset;
-        printf("        0F68:26B1  -- di = %4x\n", *output);
-
-        uint16_t word_3a805 = 0xffff;
-
-        for (int i = 0; i < single_course_data_boh; i++) {
-            buffer2[(bx + (i * 2)) + 0] = (*output & 0xff00) >> 8;
-            buffer2[(bx + (i * 2)) + 1] = (*output & 0x00ff) >> 0;
-
-            printf("            0F68:26B9  -- bx = %4x, di = %4x\n", bx + (i * 2), *output);
-
-
-            uint8_t byte_3a8f2 = barfs_course_data_lut_1[i];
-            uint8_t byte_3a8f3 = 0;
-
-            auto saved_output = *output;
+    // init_rol_buffer
+    CourseDataLevel makeLevel(uint8_t scale) {
+        CourseDataLevel level = { 0 };
+        level.scale = scale;
 
-            uint16_t word_3a7ff = 0; // (output from _element)
+        auto lut = barfs_boh_lut_2;
+        uint8_t ah = scale;
 
-            single_course_data_element(scene, element_index, output, &byte_3a8f2, &byte_3a8f3, &word_3a7ff);
+        TD_TRACE(Barfs, TraceValues, "[init_rol_buffer] scale %02x\n", scale);
 
-            auto temp = ((buffer2[word_3a7ff + 0] << 8) +
-                         (buffer2[word_3a7ff + 1] << 0));
-
-            if (temp == word_3a805) {
-                printf("                0F68:26E0 taken\n");
-                *output = saved_output;
+        if (ah >= 0x18) {
+            ah = ah - 0x18;
+            level.doublings++;
 
-                buffer2[(bx + (i * 2)) + 0] = buffer2[(bx + ((i - 1) * 2)) + 0];
-                buffer2[(bx + (i * 2)) + 1] = buffer2[(bx + ((i - 1) * 2)) + 1];
+            if (ah >= 0x18) {
+                ah = ah - 0x18;
+                level.doublings++;
             }
-            else {
-                printf("                0F68:26EC taken\n");
+        }
 
-                word_3a805 = temp;
-            }
+        uint16_t bx = 0;
 
-            printf("            0F68:26FB  -- ah = %2x bx = %4x\n", i + 1, bx + ((i + 1)* 2));
+        if (ah < 0x18) {
+            ah = 0x17 - ah;
+            bx = ah * 10;
         }
-    }
-    else {
-        printf("        0F68:268A taken\n");
-
-        if (lut2 >= 2) {
-            printf("            0F68:268F taken\n");
 
-            uint8_t byte_3a8f2 = 0x17;
-            uint8_t byte_3a8f3 = 0;
+        auto &rol = level.rolMasks;
+
+        rol[0x00] = lut[bx + 0];
+        rol[0x01] = lut[bx + 1];
+        rol[0x07] = lut[bx + 0];
+        rol[0x08] = lut[bx + 0];
+        rol[0x0e] = lut[bx + 0];
+        rol[0x0f] = lut[bx + 0];
+        rol[0x15] = lut[bx + 0];
+        rol[0x16] = lut[bx + 0];
+
+        rol[0x02] = lut[bx + 2];
+        rol[0x03] = lut[bx + 3];
+        rol[0x09] = lut[bx + 2];
+        rol[0x0a] = lut[bx + 3];
+        rol[0x10] = lut[bx + 2];
+        rol[0x11] = lut[bx + 3];
+        rol[0x17] = lut[bx + 2];
+        rol[0x18] = lut[bx + 3];
+
+        rol[0x04] = lut[bx + 4];
+        rol[0x05] = lut[bx + 5];
+        rol[0x0b] = lut[bx + 4];
+        rol[0x0c] = lut[bx + 5];
+        rol[0x12] = lut[bx + 4];
+        rol[0x13] = lut[bx + 5];
+        rol[0x19] = lut[bx + 5];
+
+        rol[0x06] = lut[bx + 7];
+        rol[0x0d] = lut[bx + 7];
+        rol[0x14] = lut[bx + 7];
+
+        uint8_t ch = lut[bx + 6];
 
-            uint16_t bx = *output;
-            printf("        0F68:269B  -- bx = %4x\n", bx);
+        if (ah >= 0x18) {
+            ah = ah - 0x18;
+            level.doublings = 3;
 
-            *output += some_offset;
-            printf("        0F68:269D  -- di = %4x\n", *output);
+            bx = 0;
 
-            for (int i = 0; i < single_course_data_boh; i++) {
-                buffer2[(bx + (i * 2)) + 0] = (*output & 0xff00) >> 8;
-                buffer2[(bx + (i * 2)) + 1] = (*output & 0x00ff) >> 0;
+            if (ah < 0x18) {
+                ah = 0x17 - ah;
+                bx = ah * 10;
             }
 
-            uint16_t word_3a7ff = 0; // (output from _element)
-            single_course_data_element(scene, element_index, output, &byte_3a8f2, &byte_3a8f3, &word_3a7ff);
+            ch = lut[bx + 7];
         }
 
-        printf("            0F68:26AC\n");
+        rol[0x1b] = ch;
+        rol[0x1c] = lut[bx + 8];
+        rol[0x1d] = lut[bx + 9];
 
+        return level;
     }
-}
 
-void barfs(TD::Scene& scene)
-{
-    auto unk1  = TD::GetWord(scene.one_dat, 0);
-    auto unk2  = TD::GetWord(scene.one_dat, 2);
-    auto unk3  = TD::GetWord(scene.one_dat, 4);
-    auto count = TD::GetWord(scene.one_dat, 6);
+    const Scene &m_scene;
+    const RawBuffer::Bytes m_file;
+    const std::vector<std::byte> &m_data;
+};
 
-    printf("scene011.dat > %04x %04x %04x %04x\n", unk1, unk2, unk3, count);
-    printf("getSingleCourseDataBoh 0x%x\n\n", scene.getSingleCourseDataBoh());
+}
 
-    uint16_t output = 0x0040;
+// Dumps the decoded table. Build with TD_TRACE_LEVEL=2 to get the trace
+// of the original routine too.
+inline void barfs(const TD::Scene& scene)
+{
+    auto elements = TD::CourseDataDecoder(scene).decode();
 
-    for (int i = 0; i < count; i++) {
-        printf("\n");
+    TD::TraceBuffer::shared().dump(stdout);
 
-        printf("    0F68:263A  --  bx = %4x\n", i);
-        printf("    0F68:263C  --  es:[bx] = di => %4x, %4x\n", i * 2, output);
+    for (auto &element : elements) {
+        printf("\nelement %2d: %2dx%-2d mode %d, %zu levels for %zu steps\n",
+               element.index, element.width, element.height, element.mode,
+               element.levels.size(), element.levelForStep.size());
 
-        buffer2[(i * 2) + 0] = (output & 0xff00) >> 8;
-        buffer2[(i * 2) + 1] = (output & 0x00ff) >> 0;
+        for (int y = 0; y < element.height; y++) {
+            printf("    ");
 
-        if (i == 0)
-            continue;
+            for (int x = 0; x < element.width; x++)
+                printf("%02x", element.pixel(x, y));
 
-        single_course_data(scene, i, &output);
+            printf("\n");
+        }
     }
-
 }
-
@@ -8,21 +8,36 @@
 #include <raylib.h>
 #include <rlgl.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <optional>
 #include <utility>
 
 #include <cstddef>
 #include <cstdlib>
+#include <future>
+#include <list>
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
 
 #include "barfs.h"
-#include "Explorer.h"
 #include "Images.h"
 #include "SceneAssets.h"
-#include "Draw3DText.h"
+#include "SceneStreamer.h"
+#include "Culling.h"
+#include "SceneBvh.h"
+#include "Profiler.h"
+#include "RenderBackend.h"
+#include "FramePipeline.h"
+#include "OcclusionBuffer.h"
+#include "HotReload.h"
+#include "CameraPath.h"
+
+// defines min() and max() macros, keep it after everything else
+#include "Explorer.h"
 
 /*
  
@@ -50,15 +65,6 @@
 
 const std::string BasePath = "data/";
 
-
-Vector3 NormalizeTDWorldLocation(TD::Point tdPos) {
-    return Vector3 {
-        .x = (tdPos.x * 4) / 4096.f - .5f,
-        .y = (tdPos.z / 8) / 4096.f,
-        .z = ((4096 * 16) - (tdPos.y * 4)) / 4096.f -.5f
-    };
-};
-
 void printa(const TD::Model &model)
 {
     if (model.polys().size() == 0)
@@ -110,20 +116,24 @@ class Screen {
 public:
     virtual void setup() = 0;
     virtual void loop() = 0;
+
+    // Release whatever GPU resources only this screen uses
+    virtual void teardown() { }
 };
 
 class ModelExplorer: public Screen {
 public:
-    ModelExplorer(SceneAssets &assets)
-        : m_assets(assets)
-        , m_explorer("MODELS EXPLORER", (int)m_assets.modelExplorerModels.size())
+    ModelExplorer(SceneStreamer &streamer, RenderBackend &backend)
+        : m_streamer(streamer)
+        , m_backend(backend)
+        , m_explorer("MODELS EXPLORER", (int)assets().modelExplorerModels.size())
     {
         m_explorer.setScale(100);
     }
 
     void setup() {
         SetCameraMode(m_explorer.camera(), CAMERA_PERSPECTIVE);
-        printa(m_assets.modelExplorerModels[m_explorer.current()]);
+        printa(*assets().modelExplorerModels[m_explorer.current()]);
     }
 
     void loop() {
@@ -132,38 +142,35 @@ public:
         m_explorer.checkInput();
 
         if (IsKeyPressed(KEY_RIGHT) || IsKeyPressed(KEY_LEFT)) {
-            printa(m_assets.modelExplorerModels[meshNr]);
+            printa(*assets().modelExplorerModels[meshNr]);
         }
 
-        m_explorer.beginDrawingObject();
-
-        DrawModelEx(m_assets.modelExplorerMeshes[meshNr]._model(),
-                    { 0 },
-                    { 0, 1, 0 },
-                    0,
-                    { 1, 1, 1 },
-                    ::WHITE);
-
-        m_explorer.endDrawingObject();
-
-        EndDrawing();
+        m_explorer.beginDrawingObject(m_backend);
+        m_backend.drawMesh(*assets().modelExplorerMeshes[meshNr], MatrixIdentity());
+        m_explorer.endDrawingObject(m_backend);
     }
 
 private:
-    SceneAssets &m_assets;
+    SceneAssets &assets() {
+        return m_streamer.assets();
+    }
+
+    SceneStreamer &m_streamer;
+    RenderBackend &m_backend;
     Explorer m_explorer;
 };
 
 class TilesExplorer: public Screen {
 public:
-    TilesExplorer(SceneAssets &assets)
-        : m_assets(assets)
-        , m_explorer("TILES EXPLORER", (int)m_assets.tileExplorerMeshes.size())
+    TilesExplorer(SceneStreamer &streamer, RenderBackend &backend)
+        : m_streamer(streamer)
+        , m_backend(backend)
+        , m_explorer("TILES EXPLORER", (int)assets().tileExplorerMeshes.size())
     { }
 
     void setup() {
         SetCameraMode(m_explorer.camera(), CAMERA_PERSPECTIVE);
-        printa(m_assets.tileExplorerModels[0]);
+        printa(*assets().tileExplorerModels[0]);
     }
 
     void loop() {
@@ -173,99 +180,235 @@ public:
 
         if (IsKeyPressed(KEY_RIGHT) || IsKeyPressed(KEY_LEFT)) {
             printf(" --- tile %d ---\n", meshNr);
-            print_sprite_data(m_assets.tileExplorerModels[meshNr]);
+            print_sprite_data(*assets().tileExplorerModels[meshNr]);
         }
 
-        BeginDrawing();
+        m_explorer.beginDrawingObject(m_backend);
 
-        m_explorer.beginDrawingObject();
-        for (auto &sprite : m_assets.tileExplorerModels[meshNr].sprites()) {
+        for (auto &sprite : assets().tileExplorerModels[meshNr]->sprites()) {
             Vector3 pos;
             pos.x =  ((int16_t) sprite.b) / 1024.;
             pos.y =  ((int16_t) sprite.d) / 4096.;
             pos.z = -((int16_t) sprite.c) / 1024.;
 
-            DrawCylinder(pos, 0.001, 0.001, .2, 16, RED);
-            DrawSphere( pos, 0.01, VIOLET);
+            m_backend.drawCylinder(pos, 0.001, .2, RED);
+            m_backend.drawSphere(pos, 0.01, VIOLET);
         }
 
-        DrawSphere({ .5, 0, 0 }, 0.05, GREEN);
-        DrawSphere({ 0, 0, .5 }, 0.05, BLUE);
+        m_backend.drawSphere({ .5, 0, 0 }, 0.05, GREEN);
+        m_backend.drawSphere({ 0, 0, .5 }, 0.05, BLUE);
 
-        DrawModel(m_assets.tileExplorerMeshes[meshNr]._model(),
-                  { 0 },
-                  1,
-                  ::WHITE);
+        m_backend.drawMesh(*assets().tileExplorerMeshes[meshNr], MatrixIdentity());
 
-        m_explorer.endDrawingObject();
-
-        EndDrawing();
+        m_explorer.endDrawingObject(m_backend);
     }
 
 private:
-    SceneAssets &m_assets;
+    SceneAssets &assets() {
+        return m_streamer.assets();
+    }
+
+    SceneStreamer &m_streamer;
+    RenderBackend &m_backend;
     Explorer m_explorer;
 };
 
 class BitmapTest: public Screen {
 public:
-    BitmapTest(TD::Resources &resources)
-        : m_menuImages(resources)
+    BitmapTest(TD::Resources &resources, RenderBackend &backend)
+        : m_backend(backend)
+        , m_menuImages(std::make_unique<TD::MenuImages>(resources))
         , m_spinner((int)resources.cars().size(), KEY_DOWN, KEY_UP)
     {
         for (auto& car : resources.cars()) {
-            m_carImages.emplace_back(car);
+            m_carImages.push_back(std::make_unique<TD::CarImages>(resources, car));
+            m_carNames.push_back(car.name);
+        }
+    }
+
+    void accountMemory(MemoryReport &report) const {
+        m_menuImages->accountMemory(report, "menu images");
+
+        for (int i = 0; i < m_carImages.size(); i++)
+            m_carImages[i]->accountMemory(report, "car images " + m_carNames[i]);
+    }
+
+    // Decoded again in the background and swapped in by update(). The
+    // source files must stay put until then.
+    void reloadMenu(TD::Resources &resources) {
+        m_pendingMenu = std::async(reloadPolicy(), [&resources] {
+            return std::make_unique<TD::MenuImages>(resources);
+        });
+    }
+
+    void reloadCar(TD::Resources &resources, int index) {
+        m_pendingCars.push_back({ index, std::async(reloadPolicy(), [&resources, index] {
+            return std::make_unique<TD::CarImages>(resources, resources.cars()[index]);
+        }) });
+    }
+
+    bool isReloading() const {
+        return m_pendingMenu.valid() || !m_pendingCars.empty();
+    }
+
+    // Main thread, between frames, whichever screen is showing. The old
+    // images take their textures with them, the new ones make theirs when
+    // first drawn.
+    void update() {
+        if (ready(m_pendingMenu)) {
+            m_menuImages = m_pendingMenu.get();
+        }
+
+        for (auto i = m_pendingCars.begin(); i != m_pendingCars.end();) {
+            if (!ready(i->second)) {
+                i++;
+                continue;
+            }
+
+            m_carImages[i->first] = i->second.get();
+            i = m_pendingCars.erase(i);
         }
     }
 
     void setup() {
     }
 
+    // The images are shared through the cache, their textures go with
+    // the last holder
+    void teardown() {
+    }
+
     void loop() {
         m_spinner.checkInput();
 
-        BeginDrawing();
+        if (IsKeyPressed(KEY_F))
+            m_mode = (Mode)((m_mode + 1) % ModeCount);
 
-        ClearBackground(::DARKGRAY);
+        m_backend.beginFrame(::DARKGRAY);
 
-        DrawTexture(m_menuImages.select.texture(),       20,  20, ::WHITE);
-        DrawTexture(m_menuImages.detail1.texture(),      20, 490, ::WHITE);
-        DrawTexture(m_menuImages.detail2.texture(),      20, 500, ::WHITE);
-        DrawTexture(m_menuImages.compass.texture(),         0, 0, ::WHITE);
+        if (m_mode != Atlas) {
+            drawFullScreen();
+            m_backend.endFrame();
+            return;
+        }
 
-        auto& carImages = m_carImages[m_spinner.current()];
+        m_backend.drawTexture(*m_menuImages->select,    20,  20);
+        m_backend.drawTexture(*m_menuImages->detail1,   20, 490);
+        m_backend.drawTexture(*m_menuImages->detail2,   20, 500);
+        m_backend.drawTexture(*m_menuImages->compass,    0,   0);
 
-        DrawTexture(carImages.sic.texture(),     20, 270, ::WHITE);
-        DrawTexture(carImages.top.texture(),    400,  20, ::WHITE);
-        DrawTexture(carImages.bot1.texture(),   400,  60, ::WHITE);
-        DrawTexture(carImages.bot2.texture(),   400, 120, ::WHITE);
-        DrawTexture(carImages.lbot.texture(),   400, 180, ::WHITE);
-        DrawTexture(carImages.rbot.texture(),   600, 180, ::WHITE);
-        DrawTexture(carImages.etc.texture(),    400, 250, ::WHITE);
+        auto& carImages = *m_carImages[m_spinner.current()];
 
-        DrawTexture(carImages.fl1.texture(),      20, 340, ::WHITE);
-        DrawTexture(carImages.fl2.texture(),     260, 340, ::WHITE);
+        m_backend.drawTexture(*carImages.sic,          20, 270);
+        m_backend.drawTexture(*carImages.top,         400,  20);
+        m_backend.drawTexture(*carImages.bot1,        400,  60);
+        m_backend.drawTexture(*carImages.bot2,        400, 120);
+        m_backend.drawTexture(*carImages.lbot,        400, 180);
+        m_backend.drawTexture(*carImages.rbot,        600, 180);
+        m_backend.drawTexture(*carImages.etc,         400, 250);
 
-        DrawTexture(carImages.bic.texture(),     670, 340, ::WHITE);
-        DrawTexture(carImages.sid.texture(),     550, 340, ::WHITE);
-        DrawTexture(carImages.icn.texture(),     550, 490, ::WHITE);
+        m_backend.drawTexture(*carImages.fl1,          20, 340);
+        m_backend.drawTexture(*carImages.fl2,         260, 340);
 
-        EndDrawing();
+        m_backend.drawTexture(*carImages.bic,         670, 340);
+        m_backend.drawTexture(*carImages.sid,         550, 340);
+        m_backend.drawTexture(*carImages.icn,         550, 490);
+
+        m_backend.endFrame();
     }
 
 private:
-    TD::MenuImages m_menuImages;
-    std::vector<TD::CarImages> m_carImages;
+    enum Mode {
+        Atlas,
+        FullScreenNearest,
+        FullScreenEpx,
+        FullScreenXbr,
+        ModeCount,
+    };
+
+    // The select screen at the largest integer scale that fits
+    void drawFullScreen() {
+        auto &image = *m_menuImages->select;
+        auto size = image.image();
+
+        auto factor = m_backend.width() / size.width;
+        if (m_backend.height() / size.height < factor)
+            factor = m_backend.height() / size.height;
+
+        if (factor < 1)
+            factor = 1;
+
+        const std::pair<TD::ImageScaler::Filter, const char *> filters[] = {
+            { TD::ImageScaler::Filter::Nearest, "NEAREST" },
+            { TD::ImageScaler::Filter::Epx,     "EPX" },
+            { TD::ImageScaler::Filter::Xbr,     "XBR" },
+        };
+
+        auto filter = filters[m_mode - FullScreenNearest];
+
+        m_backend.drawImage(image,
+                            (m_backend.width()  - size.width  * factor) / 2,
+                            (m_backend.height() - size.height * factor) / 2,
+                            factor,
+                            filter.first);
+
+        char text[50];
+        snprintf(text, sizeof(text), "%dX %s", factor, filter.second);
+        m_backend.drawText(text, 10, 10, 20, ::YELLOW);
+    }
+
+    static std::launch reloadPolicy() {
+        // without threads the decode runs in update(), on the main thread
+        return TD_THREADS_AVAILABLE ? std::launch::async : std::launch::deferred;
+    }
+
+    template <typename T>
+    static bool ready(const std::future<T> &future) {
+        return future.valid() && future.wait_for(std::chrono::seconds(0)) != std::future_status::timeout;
+    }
+
+    RenderBackend &m_backend;
+    Mode m_mode = Atlas;
+    std::unique_ptr<TD::MenuImages> m_menuImages;
+    std::vector<std::unique_ptr<TD::CarImages>> m_carImages;
+    std::vector<std::string> m_carNames;
     Spinner m_spinner;
+
+    std::future<std::unique_ptr<TD::MenuImages>> m_pendingMenu;
+    std::list<std::pair<int, std::future<std::unique_ptr<TD::CarImages>>>> m_pendingCars;
 };
 
 class CameraTest: public Screen {
 public:
-    CameraTest(TD::Resources& res, TD::Scene& scene)
-        : m_scene(scene)
-        , m_otwPalette(res.file("OTWCOL.BIN"), 0x10)
-        , m_assets(res, m_otwPalette, m_scene)
+    // Tiles each way from the camera whose terrain hides what is behind it
+    static const int OccluderRange = 6;
+
+    CameraTest(SceneStreamer &streamer, RenderBackend &backend)
+        : m_streamer(streamer)
+        , m_backend(backend)
+        , m_grid(TD::Scene::XTileCount, TD::Scene::YTileCount)
+        , m_cullingStats({ 0 })
     {
+        buildGrid();
+    }
+
+    const CullingStats &cullingStats() const {
+        return m_cullingStats;
+    }
+
+    // O toggles it too
+    void setOcclusionCulling(bool enabled) {
+        m_occlusionCulling = enabled;
+    }
+
+    // Off, the mouse and keys leave the camera alone and only flyTo()
+    // moves it, as when replaying a path
+    void setManualControl(bool enabled) {
+        m_manualControl = enabled;
+    }
+
+    const Camera &camera() const {
+        return m_camera;
     }
 
     void resetCamera() {
@@ -287,11 +430,24 @@ public:
         SetCameraMode(m_camera, CAMERA_FIRST_PERSON);
     }
 
+    // Places the camera like flying there would, for scripted paths
+    void flyTo(Vector3 position, Vector3 target) {
+        m_camera.position = position;
+        m_camera.target = target;
+
+        followTerrain();
+    }
+
     void setup() {
         resetCamera();
     }
 
     void loop() {
+        if (!m_manualControl) {
+            draw();
+            return;
+        }
+
         if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
             if (m_enableCamera) {
                 m_enableCamera = false;
@@ -307,107 +463,674 @@ public:
 
         if (m_enableCamera) {
             UpdateCamera(&m_camera);
-            m_camera.position.y = ((0x130 / 4096.f) );
+            followTerrain();
         }
 
-        BeginDrawing();
-        ClearBackground(DARKGRAY);
-        BeginMode3D(m_camera);
+        if (IsMouseButtonPressed(MOUSE_RIGHT_BUTTON))
+            pickObject();
+
+        if (IsKeyPressed(KEY_O))
+            m_occlusionCulling = !m_occlusionCulling;
+
+        draw();
+    }
+
+    // Submits the draw list built during the previous frame and starts
+    // building the next one from the current camera
+    void draw() {
+        if (m_generation != m_streamer.generation()) {
+            m_pipeline.swap();
+            buildGrid();
+            resetCamera();
+        }
+
+        if (!m_pipeline.isBuilding())
+            buildNextDrawList();
+
+        m_pipeline.swap();
+        buildNextDrawList();
+
+        submit(m_pipeline.current());
+    }
+
+private:
+    // Everything a frame draws, decided off the main thread. Only indices
+    // and CameraTest's own copies are used to build it: the scene may be
+    // swapped out while a build is running.
+    struct DrawList {
+        Camera camera;
+        std::vector<int> tiles;         // TileGrid indices
+        std::vector<int> objects;       // ObjectTable indices
+        BillboardQuads billboards;
+        CullingStats stats;
+        Profiler::Clock::time_point buildStart;
+        Profiler::Clock::time_point buildEnd;
+    };
+
+    void buildNextDrawList() {
+        auto camera = m_camera;
+        auto aspect = (float)m_backend.width() / (float)m_backend.height();
+        auto occlusion = m_occlusionCulling;
+
+        m_pipeline.build([this, camera, aspect, occlusion](DrawList &list) {
+            buildDrawList(camera, aspect, occlusion, list);
+        });
+    }
+
+    // On a pool worker; the only one touching m_billboards and
+    // m_occlusion while a build is running
+    void buildDrawList(const Camera &camera, float aspect, bool occlusion, DrawList &list) {
+        list.buildStart = Profiler::Clock::now();
+        list.camera = camera;
+        list.tiles.clear();
+        list.objects.clear();
+
+        auto frustum = Frustum(camera, aspect);
+
+        auto visitTile = [&](int x, int y) {
+            list.tiles.push_back(TD::TileGrid::index(x, y));
+        };
+
+        auto visitObject = [&](int i) {
+            list.objects.push_back(i);
+        };
+
+        if (occlusion) {
+            drawOccluders(camera, aspect, frustum);
+            list.stats = m_grid.cull(frustum, m_occlusion, visitTile, visitObject);
+        }
+        else {
+            list.stats = m_grid.cull(frustum, visitTile, visitObject);
+        }
+
+        m_billboards.build(camera, list.billboards);
+
+        list.buildEnd = Profiler::Clock::now();
+    }
+
+    // The terrain of the tiles in view around the camera. Near tiles cover
+    // most of the screen, and the hills hiding the rest are among them.
+    void drawOccluders(const Camera &camera, float aspect, const Frustum &frustum) {
+        m_occlusion.begin(camera, aspect);
+
+        auto cx = (int)floorf(camera.position.x);
+        auto cy = (int)floorf(camera.position.z);
+
+        for (int y = cy - OccluderRange; y <= cy + OccluderRange; y++) {
+            for (int x = cx - OccluderRange; x <= cx + OccluderRange; x++) {
+                if (x < 0 || y < 0 || x >= TD::Scene::XTileCount || y >= TD::Scene::YTileCount)
+                    continue;
+
+                if (frustum.isVisible(m_grid.tileBounds(x, y)))
+                    m_occlusion.drawOccluder(m_occluders.group(TD::TileGrid::index(x, y)));
+            }
+        }
+
+        m_occlusion.end();
+    }
+
+    void submit(const DrawList &list) {
+        if (Profiler::shared().enabled())
+            Profiler::shared().add("cull (worker)", list.buildStart, list.buildEnd);
+
+        auto &tiles = scene().tileGrid();
+        auto &objects = scene().objectTable();
+
+        m_backend.beginFrame(DARKGRAY);
+        m_backend.beginMode3D(list.camera);
+
+        {
+            TD_PROFILE_SCOPE("tiles");
+
+            for (auto i : list.tiles)
+                m_backend.drawMesh(tileMesh(tiles.tileId[i]), tiles.transform[i]);
+        }
+
+        {
+            TD_PROFILE_SCOPE("billboards");
+            m_backend.drawBillboards(list.billboards, assets().courseSprites);
+        }
+
+        {
+            TD_PROFILE_SCOPE("objects");
+
+            for (auto i : list.objects) {
+                drawObject(objects[i]);
+
+                if (i == m_selectedObject)
+                    m_backend.drawBoundingBox(m_bvh.objectBounds(i), ::YELLOW);
+            }
+        }
+
+        if (m_drawObjectId) {
+            m_labels.show(list.objects);
+            m_backend.drawLabels(m_labels);
+        }
+
+        m_backend.endMode3D();
+
+        m_cullingStats = list.stats;
+
+        if (m_drawCullingStats)
+            drawCullingStats();
+
+        if (m_selectedObject != SceneBvh::NoObject)
+            drawSelection();
+
+        m_backend.endFrame();
+    }
+
+    RayLibMesh &tileMesh(uint8_t tileid) {
+        return tileid < 0x40
+            ? *assets().genericTiles[tileid]
+            : *assets().tileMeshes[tileid - 0x40];
+    }
+
+    TD::Scene &scene() {
+        return m_streamer.scene();
+    }
+
+    SceneAssets &assets() {
+        return m_streamer.assets();
+    }
+
+    void buildGrid() {
+        m_generation = m_streamer.generation();
+        m_grid = SceneGrid(TD::Scene::XTileCount, TD::Scene::YTileCount);
+        m_bvh = SceneBvh();
+        m_occluders.clear();
+        m_labels.clear();
+        m_selectedObject = SceneBvh::NoObject;
+
+        auto &tiles = scene().tileGrid();
 
         for (int y = 0; y < TD::Scene::YTileCount; y++) {
             for (int x = 0; x < TD::Scene::XTileCount; x++) {
+                auto i = TD::TileGrid::index(x, y);
+                auto &mesh = tileMesh(tiles.tileId[i]);
 
-                auto tileinfo = m_scene.getTileInfo(x, y);
-                auto tileid = tileinfo.tileId();
+                m_grid.addTile(x, y, TransformBoundingBox(mesh.boundingBox(), tiles.transform[i]));
+                m_bvh.addMesh(mesh.cpuMesh(), tiles.transform[i]);
+                m_occluders.add(i, mesh.cpuMesh(), tiles.transform[i]);
+            }
+        }
 
-                auto &model = tileid < 0x40
-                    ? m_assets.genericTiles[tileid]
-                    : m_assets.tileMeshes[tileid - 0x40];
+        auto &objects = scene().objectTable();
 
-                Vector3 position;
-                position.x = x;
-                position.y = tileinfo.height() / 4096.;
-                position.z = y;
+        for (int i = 0; i < objects.size(); i++) {
+            auto &object = objects[i];
+            auto m = assets().meshForModelId(object.modelId, object.isLOD);
 
-                DrawModelEx(model._model(),
-                            position,
-                            { 0, 1, 0 },
-                            -tileinfo.rot() * 90,
-                            { 1, 1, 1 },
-                            ::WHITE);
-            }
+            m_grid.addObject(i, TransformBoundingBox(m->boundingBox(), object.transform));
+            m_bvh.addMesh(m->cpuMesh(), object.transform, i);
+
+            addLabel(i, object, m->boundingBox());
         }
 
-        for (auto &i : m_scene.m_objects) {
-            auto m = m_assets.meshForModelId(i.modelId(), i.isLOD());
+        m_bvh.build();
 
-            if (!m)
-                continue;
+        buildTileSprites();
+    }
 
-            auto model  = m->_model();
-            auto position = NormalizeTDWorldLocation(i.location());
-            auto angle = -(i.rotation()) * 90;
-            auto bb = GetModelBoundingBox(model);
+    // Every billboard the tiles place, in world space
+    void buildTileSprites() {
+        auto &tiles = scene().tileGrid();
 
-            rlPushMatrix();
-            {
-                rlTranslatef(position.x, position.y, position.z);
+        m_billboards.clear();
 
-                rlPushMatrix();
-                {
-                    rlRotatef(angle, 0, 1, 0);
+        for (int i = 0; i < TD::TileGrid::Count; i++) {
+            for (auto &sprite : assets().tileModel(tiles.tileId[i]).sprites()) {
+                auto courseSprite = assets().courseSprites.sprite(sprite.a & 0x1f);
 
-                    DrawModel(model, { 0 }, 1, ::WHITE);
+                if (!courseSprite)
+                    continue;
 
-                    if (m_drawBoundingBox)
-                        DrawBoundingBox(bb, ::PURPLE);
-                }
-                rlPopMatrix();
-
-                if (m_drawObjectId) {
-                    rlPushMatrix();
-                    rlTranslatef(bb.max.x, bb.max.y, bb.min.z);
-                    rlScalef(.005,.005f,.005f);
-                    rlRotatef(90, 1, 0, 0);
-                    rlRotatef(90, 0, 0, 1);
-
-                    char suca[30];
-                    snprintf(suca, sizeof(suca), "ID: %02x\nFLAGS: %04x", i.modelId(), i.flags());
-                    DrawText3D(suca, { 0 }, 8, ::MAROON);
-                    rlPopMatrix();
-                }
+                Vector3 local = {
+                     ((int16_t) sprite.b) / 1024.f,
+                     ((int16_t) sprite.d) / 4096.f + courseSprite->height / 2,
+                    -((int16_t) sprite.c) / 1024.f,
+                };
 
+                m_billboards.add(Vector3Transform(local, tiles.transform[i]), *courseSprite);
             }
-            rlPopMatrix();
-        };
+        }
+    }
 
-        EndMode3D();
+    // Keeps the eyes at a fixed height over the ground, moving the target
+    // along so the view direction does not change
+    void followTerrain() {
+        const float EyeHeight = 0x130 / 4096.f;
 
-        EndDrawing();
+        TD_PROFILE_SCOPE("ground query");
+        auto ground = m_bvh.groundHeight(m_camera.position.x, m_camera.position.z);
+        auto y = ground ? *ground + EyeHeight : EyeHeight;
+        auto delta = y - m_camera.position.y;
+
+        m_camera.position.y += delta;
+        m_camera.target.y += delta;
     }
 
-private:
-    TD::Scene &m_scene;
-    TD::GamePalette m_otwPalette;
-    SceneAssets m_assets;
+    // Object under the mouse, or under the crosshair while flying around.
+    // Hitting the ground selects the closest object nearby, if any.
+    void pickObject() {
+        auto mouse = m_enableCamera
+            ? Vector2 { GetScreenWidth() / 2.f, GetScreenHeight() / 2.f }
+            : GetMousePosition();
+
+        m_selectedObject = SceneBvh::NoObject;
+
+        auto hit = m_bvh.raycast(GetMouseRay(mouse, m_camera));
+
+        if (!hit)
+            return;
+
+        m_selectedObject = hit->object != SceneBvh::NoObject
+            ? hit->object
+            : m_bvh.nearestObject(hit->point, .5f);
+    }
+
+    // Next to the top corner of the object's bounds, facing up
+    void addLabel(int index, const TD::PlacedObject &object, const BoundingBox &bb) {
+        auto transform = MatrixMultiply(MatrixRotateZ(90 * DEG2RAD), MatrixRotateX(90 * DEG2RAD));
+        transform = MatrixMultiply(transform, MatrixScale(.005f, .005f, .005f));
+        transform = MatrixMultiply(transform, MatrixTranslate(bb.max.x, bb.max.y, bb.min.z));
+        transform = MatrixMultiply(transform, MatrixTranslate(object.position.x, object.position.y, object.position.z));
+
+        char text[30];
+        snprintf(text, sizeof(text), "ID: %02x\nFLAGS: %04x", object.modelId, object.flags);
+
+        m_labels.set(index, text, transform, 8, ::MAROON);
+    }
+
+    void drawObject(const TD::PlacedObject &i) {
+        auto m = assets().meshForModelId(i.modelId, i.isLOD);
+        auto bb = m->boundingBox();
+
+        m_backend.drawMesh(*m, i.transform);
+
+        if (m_drawBoundingBox) {
+            m_backend.pushMatrix(i.transform);
+            m_backend.drawBoundingBox(bb, ::PURPLE);
+            m_backend.popMatrix();
+        }
+    }
+
+    void drawCullingStats() {
+        char stats[100];
+        snprintf(stats, sizeof(stats), "CELLS %d/%d  TILES %d/%d  OBJECTS %d/%d",
+                 m_cullingStats.visibleCells,
+                 m_cullingStats.visibleCells   + m_cullingStats.culledCells   + m_cullingStats.occludedCells,
+                 m_cullingStats.visibleTiles,
+                 m_cullingStats.visibleTiles   + m_cullingStats.culledTiles   + m_cullingStats.occludedTiles,
+                 m_cullingStats.visibleObjects,
+                 m_cullingStats.visibleObjects + m_cullingStats.culledObjects + m_cullingStats.occludedObjects);
+
+        m_backend.drawText(stats, 10, 10, 20, ::YELLOW);
+
+        if (!m_occlusionCulling)
+            return;
+
+        snprintf(stats, sizeof(stats), "OCCLUDED  CELLS %d  TILES %d  OBJECTS %d",
+                 m_cullingStats.occludedCells, m_cullingStats.occludedTiles, m_cullingStats.occludedObjects);
+
+        m_backend.drawText(stats, 10, 35, 20, ::YELLOW);
+    }
+
+    void drawSelection() {
+        auto &object = scene().objectTable()[m_selectedObject];
+
+        char text[100];
+        snprintf(text, sizeof(text), "OBJECT %d  MODEL %d  FLAGS %04x  ROT %d",
+                 object.slot, object.modelId, object.flags, scene().m_objects[object.slot].rotation());
+
+        m_backend.drawText(text, 10, 60, 20, ::YELLOW);
+    }
+
+    SceneStreamer &m_streamer;
+    RenderBackend &m_backend;
+    int m_generation;
+    SceneGrid m_grid;
+    SceneBvh m_bvh;
+    TextLabels m_labels;
+    BillboardBatch m_billboards;
+    OccluderSet m_occluders;
+    OcclusionBuffer m_occlusion;
+    int m_selectedObject = SceneBvh::NoObject;
+    CullingStats m_cullingStats;
     Camera m_camera;
     bool m_enableCamera = true;
     bool m_drawBoundingBox = true;
     bool m_drawObjectId = true;
+    bool m_drawCullingStats = true;
+    bool m_occlusionCulling = true;
+    bool m_manualControl = true;
+
+    // last, so it is destroyed first and no build outlives what it reads
+    FramePipeline<DrawList> m_pipeline;
+};
+
+// CameraTest drawn by the software renderer at the game's resolution,
+// scaled up to the window
+class SoftwareView: public Screen {
+public:
+    SoftwareView(SceneStreamer &streamer)
+        : m_backend(320, 200)
+        , m_cameraTest(streamer, m_backend)
+    { }
+
+    void setup() {
+        m_cameraTest.setup();
+    }
+
+    void teardown() {
+        m_texture.reset();
+    }
+
+    CameraTest &cameraTest() {
+        return m_cameraTest;
+    }
+
+    void loop() {
+        if (IsKeyPressed(KEY_P)) {
+            auto &renderer = m_backend.renderer();
+            renderer.setOrdering(renderer.ordering() == SoftwareRenderer::Ordering::Depth
+                                 ? SoftwareRenderer::Ordering::Painter
+                                 : SoftwareRenderer::Ordering::Depth);
+        }
+
+        m_cameraTest.loop();
+
+        auto &renderer = m_backend.renderer();
+
+        if (!m_texture)
+            m_texture.emplace(renderer.image());
+        else
+            UpdateTexture(m_texture->texture(), renderer.pixels());
+
+        auto source = Rectangle { 0, 0, (float)renderer.width(), (float)renderer.height() };
+        auto screen = Rectangle { 0, 0, (float)GetScreenWidth(), (float)GetScreenHeight() };
+
+        char text[100];
+        snprintf(text, sizeof(text), "SOFTWARE %s  %d TRIANGLES",
+                 renderer.ordering() == SoftwareRenderer::Ordering::Depth ? "DEPTH" : "PAINTER",
+                 renderer.triangleCount());
+
+        BeginDrawing();
+        DrawTexturePro(m_texture->texture(), source, screen, { 0 }, 0, ::WHITE);
+        DrawText(text, 10, 10, 20, ::YELLOW);
+        Profiler::shared().drawOverlay(GetScreenWidth() - 270, 10);
+        EndDrawing();
+    }
+
+private:
+    SoftwareBackend m_backend;
+    CameraTest m_cameraTest;
+    std::optional<GpuTexture> m_texture;
 };
 
 int mainTestBarfs()
 {
     auto res = TD::Resources(BasePath);
-    auto &scene = res.m_scenes[0];
+    auto scene = res.loadScene(res.trackNames()[0]);
 
     barfs(scene);
+
+    TD::TraceBuffer::shared().save("barfs.trace");
+    exit(0);
+}
+
+// Prints a trace saved by a TD_TRACE_LEVEL build, for diffing against
+// the emulator's
+int mainDumpTrace(const char *path)
+{
+    if (!TD::TraceBuffer::print(path, stdout)) {
+        fprintf(stderr, "can't read trace %s\n", path);
+        exit(1);
+    }
+
     exit(0);
 }
 
+int mainBenchMeshBuilder()
+{
+    auto res = TD::Resources(BasePath);
+    auto scene = res.loadScene(res.trackNames()[0]);
+    auto otwPalette = TD::GamePalette(res.file("OTWCOL.BIN"), 0x10);
+    auto models = SceneAssets::allModels(res, scene);
+
+    auto &pool = ThreadPool::shared();
+    auto &colors = scene.colorTable(otwPalette);
+    std::vector<CpuMesh> meshes(models.size());
+
+    auto timed = [](auto body) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    for (int run = 0; run < 5; run++) {
+        auto serial = timed([&] {
+            for (int i = 0; i < models.size(); i++)
+                meshes[i] = MeshBuilder::build(*models[i], colors);
+        });
+
+        auto parallel = timed([&] {
+            pool.parallelFor((int)models.size(), [&](int i) {
+                meshes[i] = MeshBuilder::build(*models[i], colors);
+            });
+        });
+
+        printf("%zu meshes: serial %.3f ms, %d workers %.3f ms\n",
+               models.size(), serial, pool.workerCount() + 1, parallel);
+    }
+
+    exit(0);
+}
+
+// Flies CameraTest around the track with nothing drawn, to time what the
+// traversal and submission cost the CPU on their own. No window needed.
+int mainBenchTraversal()
+{
+    const int Frames = 600;
+
+    auto resources = TD::Resources(BasePath);
+    auto otwPalette = TD::GamePalette(resources.file("OTWCOL.BIN"), 0x10);
+
+    auto streamer = SceneStreamer(resources, otwPalette);
+    streamer.loadNow(resources.trackNames()[0]);
+
+    auto backend = NullBackend(320 * 3, 200 * 3);
+    auto cameraTest = CameraTest(streamer, backend);
+    cameraTest.setup();
+
+    // an ellipse over the tile grid, looking where it is going
+    auto pathPoint = [](int frame) {
+        auto t = 2 * PI * frame / Frames;
+
+        return Vector3 {
+            TD::TileGrid::XTileCount / 2.f + cosf(t) * TD::TileGrid::XTileCount * .4f,
+            0,
+            TD::TileGrid::YTileCount / 2.f + sinf(t) * TD::TileGrid::YTileCount * .4f,
+        };
+    };
+
+    // frustum culling alone, then with occlusion culling
+    for (auto occlusion : { false, true }) {
+        cameraTest.setOcclusionCulling(occlusion);
+
+        std::vector<double> times;
+        long long commands = 0;
+        long long meshes = 0;
+        long long billboards = 0;
+        long long triangles = 0;
+        long long occludedTiles = 0;
+        long long occludedObjects = 0;
+
+        for (int frame = 0; frame < Frames; frame++) {
+            cameraTest.flyTo(pathPoint(frame), pathPoint(frame + 1));
+
+            auto start = std::chrono::steady_clock::now();
+            cameraTest.draw();
+            auto end = std::chrono::steady_clock::now();
+
+            times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+            commands   += backend.drawCount();
+            meshes     += backend.count(RenderCommand::Mesh);
+            billboards += backend.count(RenderCommand::Billboard);
+            triangles  += backend.triangles();
+
+            occludedTiles   += cameraTest.cullingStats().occludedTiles;
+            occludedObjects += cameraTest.cullingStats().occludedObjects;
+        }
+
+        std::sort(times.begin(), times.end());
+
+        double total = 0;
+        for (auto time : times)
+            total += time;
+
+        printf("%s\n", occlusion ? "occlusion culling:" : "frustum culling:");
+
+        printf("%d frames: avg %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+               Frames, total / Frames, times[Frames / 2], times[Frames * 99 / 100], times.back());
+
+        printf("per frame: %lld commands, %lld meshes, %lld billboards, %lld triangles, %lld tiles and %lld objects occluded\n",
+               commands / Frames, meshes / Frames, billboards / Frames, triangles / Frames,
+               occludedTiles / Frames, occludedObjects / Frames);
+    }
+
+    exit(0);
+}
+
+// Renders the traversal path with the software renderer in both orderings
+// and saves the first frame of each. No window needed.
+int mainBenchSoftwareRenderer()
+{
+    const int Frames = 120;
+
+    auto resources = TD::Resources(BasePath);
+    auto otwPalette = TD::GamePalette(resources.file("OTWCOL.BIN"), 0x10);
+
+    auto streamer = SceneStreamer(resources, otwPalette);
+    streamer.loadNow(resources.trackNames()[0]);
+
+    for (auto scale : { 1, 3 }) {
+        auto backend = SoftwareBackend(320 * scale, 200 * scale);
+        auto cameraTest = CameraTest(streamer, backend);
+        cameraTest.setup();
+
+        for (auto ordering : { SoftwareRenderer::Ordering::Depth, SoftwareRenderer::Ordering::Painter }) {
+            auto name = ordering == SoftwareRenderer::Ordering::Depth ? "depth" : "painter";
+            backend.renderer().setOrdering(ordering);
+
+            double total = 0;
+            long long triangles = 0;
+
+            for (int frame = 0; frame < Frames; frame++) {
+                auto t = 2 * PI * frame / Frames;
+                auto point = [&](float t) {
+                    return Vector3 {
+                        TD::TileGrid::XTileCount / 2.f + cosf(t) * TD::TileGrid::XTileCount * .4f,
+                        0,
+                        TD::TileGrid::YTileCount / 2.f + sinf(t) * TD::TileGrid::YTileCount * .4f,
+                    };
+                };
+
+                cameraTest.flyTo(point(t), point(t + .01f));
+
+                auto start = std::chrono::steady_clock::now();
+                cameraTest.draw();
+                total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                triangles += backend.renderer().triangleCount();
+
+                if (frame == 0) {
+                    char path[100];
+                    snprintf(path, sizeof(path), "software-%s-%dx.png", name, scale);
+                    ExportImage(backend.renderer().image(), path);
+                }
+            }
+
+            printf("%dx%d %-7s: %.3f ms per frame, %lld triangles, %d workers\n",
+                   320 * scale, 200 * scale, name, total / Frames, triangles / Frames,
+                   ThreadPool::shared().workerCount() + 1);
+        }
+    }
+
+    exit(0);
+}
+
+// Swaps edited data in between frames, rebuilding only what it feeds.
+// Images and the current scene are decoded again in the background; the
+// shared models are pointed at by the scene's assets, so changes to them
+// reload the scene on the spot.
+void reloadData(const DataChanges &changes,
+                TD::Resources &resources,
+                TD::GamePalette &otwPalette,
+                SceneStreamer &streamer,
+                BitmapTest &bitmapTest)
+{
+    changes.print();
+
+    resources.reloadFileTable();
+
+    // the old images stay with whoever still draws them
+    for (auto &entry : changes.entries)
+        resources.imageCache().invalidate({ entry.archive, entry.hash1, entry.hash2 });
+
+    auto reloadScene = changes.archive(streamer.sceneName() + ".dat");
+    auto reloadModels = changes.file("SCENETTT.BIN") || changes.file("SCENETTO.BIN");
+
+    if (changes.file("OTWCOL.BIN")) {
+        // the new version makes every colour table be rebuilt
+        otwPalette = TD::GamePalette(resources.file("OTWCOL.BIN"), 0x10);
+        reloadScene = true;
+    }
+
+    for (int i = 0; i < resources.cars().size(); i++) {
+        auto &name = resources.cars()[i].name;
+
+        if (changes.archive(name + ".dat")) {
+            resources.reloadCar(i);
+            bitmapTest.reloadCar(resources, i);
+        }
+
+        if (changes.archive(name + ".pob")) {
+            resources.reloadCarModel(i);
+            reloadModels = true;
+        }
+    }
+
+    for (auto name : { "SELCOLR.BIN", "SELECT.LZ", "COMPASS.LZ", "DETAIL1.LZ", "DETAIL2.LZ" }) {
+        if (changes.file(name)) {
+            bitmapTest.reloadMenu(resources);
+            break;
+        }
+    }
+
+    if (reloadModels) {
+        try {
+            resources.reloadGenericModels();
+        }
+        catch (const TD::BadData &error) {
+            printf("[reload] shared models rejected: %s\n", error.what());
+        }
+
+        streamer.reloadNow();
+    }
+    else if (reloadScene) {
+        streamer.request(streamer.sceneName());
+    }
+}
+
 int main()
 {
 //    mainTestBarfs();
+//    mainBenchMeshBuilder();
+//    mainDumpTrace("barfs.trace");
+//    mainBenchTraversal();
+//    mainBenchSoftwareRenderer();
     const int multiplicator = 3;
 
     const int TD3ScreenSizeWidth  = 320;
@@ -417,15 +1140,20 @@ int main()
     const int screenHeight = TD3ScreenSizeHeight * multiplicator;
 
     auto resources = TD::Resources(BasePath);
-    auto& scene = resources.m_scenes[0];
 
     auto otwPalette = TD::GamePalette(resources.file("OTWCOL.BIN"), 0x10);
 
-    auto assets = SceneAssets(resources, otwPalette, scene);
-    auto cameraTest = CameraTest(resources, scene);
-    auto bitmapTest = BitmapTest(resources);
-    auto modelExplorer = ModelExplorer(assets);
-    auto tilesExplorer = TilesExplorer(assets);
+    auto streamer = SceneStreamer(resources, otwPalette);
+    streamer.loadNow(resources.trackNames()[0]);
+
+    auto backend = RaylibBackend();
+
+    auto cameraTest = CameraTest(streamer, backend);
+    auto bitmapTest = BitmapTest(resources, backend);
+    auto modelExplorer = ModelExplorer(streamer, backend);
+    auto tilesExplorer = TilesExplorer(streamer, backend);
+    auto softwareView = SoftwareView(streamer);
+    auto dataWatcher = DataWatcher(resources);
 
     SetTargetFPS(30);
     SetConfigFlags(FLAG_WINDOW_RESIZABLE);
@@ -434,31 +1162,186 @@ int main()
 
     rlDisableBackfaceCulling();
 
-    Screen* currentScreen = &cameraTest;
+    streamer.assets().registry.uploadAll();
+
+    // picked by the number keys, in this order
+    Screen *screens[] = { &modelExplorer, &tilesExplorer, &bitmapTest, &cameraTest, &softwareView };
+    const char *screenNames[] = { "models explorer", "tiles explorer", "bitmap test", "camera test", "software renderer" };
+    const int ScreenCount = sizeof(screens) / sizeof(screens[0]);
+
+    int currentIndex = 3;
+    Screen* currentScreen = screens[currentIndex];
     currentScreen->setup();
 
+    auto switchTo = [&](int index) {
+        currentScreen->teardown();
+        currentIndex = index;
+        currentScreen = screens[index];
+        currentScreen->setup();
+
+        GpuStats::shared().print(screenNames[index]);
+    };
+
+    // the one flying the camera of the screen showing, if any
+    auto currentCameraTest = [&]() -> CameraTest * {
+        if (currentScreen == &cameraTest)
+            return &cameraTest;
+
+        if (currentScreen == &softwareView)
+            return &softwareView.cameraTest();
+
+        return nullptr;
+    };
+
+    auto sceneIndex = [&] {
+        auto &names = resources.trackNames();
+        return (int)(std::find(names.begin(), names.end(), streamer.sceneName()) - names.begin());
+    };
+
+    // F5 starts and stops recording, F6 plays the recording back
+    const char *CameraPathFile = "camera.path";
+    std::optional<CameraPath> recording;
+    std::optional<CameraPathReplay> replay;
+    bool profilerWasEnabled = false;
+
+    auto setManualControl = [&](bool enabled) {
+        cameraTest.setManualControl(enabled);
+        softwareView.cameraTest().setManualControl(enabled);
+    };
+
     while (!WindowShouldClose()) {
-        if (IsKeyPressed(KEY_ONE)) {
-            currentScreen = &modelExplorer;
-            currentScreen->setup();
+        if (replay) {
+            auto &frame = replay->frame();
+
+            // not a frame's cost, load it outside of them
+            if (frame.scene != sceneIndex() && frame.scene < resources.trackNames().size()) {
+                streamer.loadNow(resources.trackNames()[frame.scene]);
+                streamer.assets().registry.uploadAll();
+            }
+
+            if (frame.screen != currentIndex && frame.screen < ScreenCount)
+                switchTo(frame.screen);
+
+            auto camera = currentCameraTest();
+
+            if (camera && frame.hasCamera)
+                camera->flyTo(frame.position, frame.target);
         }
+        else {
+            for (int i = 0; i < ScreenCount; i++) {
+                if (IsKeyPressed(KEY_ONE + i))
+                    switchTo(i);
+            }
+
+            if (IsKeyPressed(KEY_N)) {
+                streamer.requestNext();
+            }
+
+            if (IsKeyPressed(KEY_F5)) {
+                if (recording) {
+                    if (recording->save(CameraPathFile))
+                        printf("[replay] recorded %zu frames to %s\n", recording->frames.size(), CameraPathFile);
+                    else
+                        printf("[replay] can't write %s\n", CameraPathFile);
+
+                    recording.reset();
+                }
+                else {
+                    recording.emplace();
+                }
+            }
 
-        if (IsKeyPressed(KEY_TWO)) {
-            currentScreen = &tilesExplorer;
-            currentScreen->setup();
+            if (IsKeyPressed(KEY_F6) && !recording) {
+                auto path = CameraPath::load(CameraPathFile);
+
+                if (path && !path->frames.empty()) {
+                    replay.emplace(std::move(*path));
+                    profilerWasEnabled = Profiler::shared().enabled();
+                    Profiler::shared().setEnabled(true);
+                    setManualControl(false);
+                    SetTargetFPS(0);
+                }
+                else {
+                    printf("[replay] can't read %s\n", CameraPathFile);
+                }
+            }
         }
 
-        if (IsKeyPressed(KEY_THREE)) {
-            currentScreen = &bitmapTest;
-            currentScreen->setup();
+        if (streamer.update()) {
+            GpuStats::shared().print(streamer.sceneName().c_str());
+            streamer.arena().print();
         }
 
-        if (IsKeyPressed(KEY_FOUR)) {
-            currentScreen = &cameraTest;
-            currentScreen->setup();
+        bitmapTest.update();
+
+        // one round of reloads at a time, each reading what the last left
+        if (!replay && !streamer.isLoading() && !bitmapTest.isReloading()) {
+            if (auto changes = dataWatcher.poll())
+                reloadData(*changes, resources, otwPalette, streamer, bitmapTest);
         }
 
+        if (IsKeyPressed(KEY_F3)) {
+            Profiler::shared().setEnabled(!Profiler::shared().enabled());
+        }
+
+        // F4 by subsystem, with shift by asset too
+        if (IsKeyPressed(KEY_F4)) {
+            MemoryReport report;
+            resources.accountMemory(report);
+            streamer.accountMemory(report);
+            bitmapTest.accountMemory(report);
+
+            report.print(streamer.sceneName().c_str(), IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT));
+            resources.imageCache().print();
+            streamer.arena().print();
+            Arena::scratch().print();
+        }
+
+        if (IsKeyPressed(KEY_F12) && !Profiler::shared().isCapturing()) {
+            Profiler::shared().capture(120, "profile.json");
+        }
+
+        Profiler::shared().beginFrame();
         currentScreen->loop();
+        Profiler::shared().endFrame();
+
+        if (recording) {
+            auto camera = currentCameraTest();
+            auto scene = sceneIndex();
+
+            // a replay could not load it back
+            if (scene >= (int)resources.trackNames().size() || scene > UINT8_MAX) {
+                printf("[replay] %s is not a track, recording stopped and dropped\n", streamer.sceneName().c_str());
+                recording.reset();
+            }
+            else {
+                CameraPath::Frame frame = { 0 };
+
+                if (camera) {
+                    frame.position = camera->camera().position;
+                    frame.target = camera->camera().target;
+                    frame.hasCamera = true;
+                }
+
+                frame.screen = (uint8_t)currentIndex;
+                frame.scene = (uint8_t)scene;
+
+                recording->frames.push_back(frame);
+            }
+        }
+
+        if (replay) {
+            replay->frameDone(Profiler::shared());
+
+            if (replay->done()) {
+                replay->print();
+                replay.reset();
+
+                Profiler::shared().setEnabled(profilerWasEnabled);
+                setManualControl(true);
+                SetTargetFPS(30);
+            }
+        }
     }
     
     return 0;